@@ -24,6 +24,7 @@
 #include "reloadableitem.h"
 #include "src/gui/renderer.h"
 #include "src/logic/picmi.h"
+#include "src/settings.h"
 
 class StreakItem : public QGraphicsTextItem, public ReloadableItem
 {
@@ -32,6 +32,7 @@
 #include <QStatusBar>
 
 #include "src/constants.h"
+#include "src/logic/kdeadapter.h"
 #include "src/logic/levelloader.h"
 #include "src/logic/picmi.h"
 #include "src/settings.h"
@@ -53,7 +54,13 @@ MainWindow::MainWindow(QWidget *parent) :
     setupActions();
     restoreWindowState();
 
-    startRandomGame();
+    /* Levels are loaded in the background, so the level selection usually
+       opens instantly. */
+    LevelLibrary::instance();
+
+    if (!restoreGame()) {
+        startRandomGame();
+    }
 }
 
 void MainWindow::setupActions() {
@@ -148,8 +155,16 @@ void MainWindow::saveStackSizeChanged(int size)
     m_action_load_state->setEnabled(size != 0);
 }
 
+void MainWindow::changeEvent(QEvent *event) {
+    if (event->type() == QEvent::LanguageChange) {
+        Level::languageChanged();
+    }
+    KXmlGuiWindow::changeEvent(event);
+}
+
 void MainWindow::closeEvent(QCloseEvent *event) {
     saveWindowState();
+    m_journal.snapshot();
     KXmlGuiWindow::closeEvent(event);
 }
 
@@ -197,7 +212,7 @@ void MainWindow::loadState() {
 }
 
 void MainWindow::startRandomGame() {
-    m_game = QSharedPointer<Picmi>(new Picmi());
+    m_game = KdeAdapter::createRandomGame();
     m_mode = Random;
 
     startGame();
@@ -205,31 +220,79 @@ void MainWindow::startRandomGame() {
 
 void MainWindow::restartGame()
 {
-    m_game = QSharedPointer<Picmi>(new Picmi(m_game->getBoardMap()));
+    m_game = QSharedPointer<Picmi>(new Picmi(m_game->getBoardMap(), m_game->preventMistakes()));
 
     startGame();
 }
 
 void MainWindow::startPresetGame(QSharedPointer<Level> board) {
-    QSharedPointer<BoardMap> p(new BoardMap(board->width(), board->height(), board->map()));
-    m_game = QSharedPointer<Picmi>(new Picmi(p));
+    m_game = QSharedPointer<Picmi>(new Picmi(board->boardMap()));
     m_mode = Preset;
     m_current_level = board;
+    m_level_key = board->key();
 
     startGame();
 }
 
+bool MainWindow::restoreGame() {
+    QString tag;
+    QSharedPointer<Picmi> game = m_journal.restore(&tag);
+    if (!game) {
+        return false;
+    }
+
+    /* Preset games are tagged with their level key. The game continues
+       right away, its level is looked up once the library has loaded. */
+
+    m_game = game;
+    m_mode = tag.isEmpty() ? Random : Preset;
+    m_current_level.clear();
+    m_level_key = tag;
+
+    startGame();
+
+    if (m_mode == Preset) {
+        LevelLibrary *library = LevelLibrary::instance();
+        if (library->isLoaded()) {
+            levelsLoaded();
+        } else {
+            connect(library, &LevelLibrary::loaded, this, &MainWindow::levelsLoaded);
+        }
+    }
+
+    return true;
+}
+
+void MainWindow::levelsLoaded() {
+    LevelLibrary *library = LevelLibrary::instance();
+    disconnect(library, &LevelLibrary::loaded, this, &MainWindow::levelsLoaded);
+
+    /* Another game may have been started in the meantime. */
+
+    if (m_mode != Preset || m_current_level) {
+        return;
+    }
+
+    const QList<QSharedPointer<Level> > levels = library->levels();
+    for (int i = 0; i < levels.size(); i++) {
+        if (levels[i]->key() == m_level_key) {
+            m_current_level = levels[i];
+            return;
+        }
+    }
+}
+
 void MainWindow::startGame() {
 
     if (m_scene) {
         disconnect(&m_timer, &QTimer::timeout, this, &MainWindow::updatePlayedTime);
     }
 
-    m_action_undo->setEnabled(false);
+    m_action_undo->setEnabled(m_game->undoStackSize() != 0);
     m_action_hint->setEnabled(true);
     m_action_solve->setEnabled(true);
     m_action_save_state->setEnabled(true);
-    m_action_load_state->setEnabled(false);
+    m_action_load_state->setEnabled(m_game->saveStackSize() != 0);
     m_action_pause->setEnabled(true);
     m_action_pause->setChecked(false);
     m_status_position->setVisible(true);
@@ -253,6 +316,11 @@ void MainWindow::startGame() {
     connect(m_game.data(), SIGNAL(undoStackSizeChanged(int)), this, SLOT(undoStackSizeChanged(int)));
     connect(m_game.data(), SIGNAL(saveStackSizeChanged(int)), this, SLOT(saveStackSizeChanged(int)));
 
+    /* Restored games are already being journaled. */
+    if (m_journal.game() != m_game) {
+        m_journal.start(m_game, (m_mode == Preset) ? m_level_key : QString());
+    }
+
     m_in_progress = true;
 }
 
@@ -276,7 +344,7 @@ QSharedPointer<KScoreDialog> MainWindow::createScoreDialog() {
 }
 
 void MainWindow::gameWon() {
-    KScoreDialog::FieldInfo score = m_game->endGame();
+    KScoreDialog::FieldInfo score = KdeAdapter::endGame(m_game.data());
     bool notified = false;
     m_status_position->setVisible(false);
     if (m_mode == Random) {
@@ -290,7 +358,10 @@ void MainWindow::gameWon() {
         }
     } else if (m_mode == Preset) {
         m_load_game->setVisible(true);
-        m_current_level->setSolved(m_game->elapsedSecs());
+        /* The level of a restored game may have been removed since. */
+        if (m_current_level) {
+            m_current_level->setSolved(m_game->elapsedSecs());
+        }
     }
 
     /* Ensure that the user gets some kind of feedback about solving the board. */
@@ -312,6 +383,7 @@ void MainWindow::gameCompleted() {
     m_action_load_state->setEnabled(false);
     Kg::difficulty()->setGameRunning(false);
     m_timer.stop();
+    m_journal.discard();
     m_in_progress = false;
 }
 
@@ -28,6 +28,7 @@
 #include <kxmlguiwindow.h>
 #include <kgdifficulty.h>
 
+#include "src/logic/gamejournal.h"
 #include "view.h"
 
 class Level;
@@ -42,6 +43,7 @@ public:
     explicit MainWindow(QWidget *parent = 0);
 
 protected:
+    void changeEvent(QEvent *event);
     void closeEvent(QCloseEvent *event);
 
 private slots:
@@ -62,6 +64,8 @@ private slots:
     void updatePositions();
     void loadBoard();
     void toggleFullscreen(bool full_screen);
+    /* looks up the level of a restored preset game once the library is loaded */
+    void levelsLoaded();
 
     /* Enable or disable undo/save state related actions. */
     void undoStackSizeChanged(int size);
@@ -76,6 +80,9 @@ private:
     void startGame();
     void startPresetGame(QSharedPointer<Level> board);
 
+    /* continues the game journaled during the last session, if any */
+    bool restoreGame();
+
     void restoreWindowState();
     void saveWindowState();
     void pauseGame();
@@ -94,6 +101,7 @@ private:
     QSharedPointer<Picmi> m_game;
     QSharedPointer<Scene> m_scene;
     QTimer m_timer;
+    GameJournal m_journal;
 
     const QString m_key_pos;
 
@@ -101,6 +109,9 @@ private:
     enum Mode m_mode;
 
     QSharedPointer<Level> m_current_level;
+    /* the key of the preset level, which is known before the level itself
+       for restored games */
+    QString m_level_key;
 };
 
 #endif // MAINWINDOW_H
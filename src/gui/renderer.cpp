@@ -19,23 +19,71 @@
 #include "config.h"
 #include "renderer.h"
 
+#include <QCoreApplication>
 #include <QDir>
 #include <QFile>
 #include <QPainter>
-#include <QPixmapCache>
+#include <QPointer>
 #include <QStandardPaths>
+#include <QThreadStorage>
+#include <QtConcurrentMap>
+#include <QtSvg/QSvgRenderer>
 #include <assert.h>
 #include <iostream>
 
 #include "src/constants.h"
+#include "src/logic/kdeadapter.h"
 #include "src/outofboundsexception.h"
 #include "src/settings.h"
 #include "src/systemexception.h"
 
 #define MIN_STREAK_COUNT (4)
 
-Renderer::Renderer() : m_tilesize(47), m_overview_tilesize(12),
-    m_streak_grid_count(6)
+/* Resizing the window back and forth reuses recently rendered tiles, as long
+   as they fit into this many bytes. */
+#define TILE_CACHE_BYTES (48 * 1024 * 1024)
+
+/* Sizes are predicted and rendered ahead of time once no resize has
+   happened for this many milliseconds. */
+#define PREWARM_DELAY (300)
+
+/* QSvgRenderer is not thread-safe. The GUI thread and each worker
+   thread rasterizing tiles load the theme into a renderer of their own. */
+static QThreadStorage<QSvgRenderer *> svg_renderers;
+
+static QSvgRenderer *svgRenderer(const QString &filename) {
+    if (!svg_renderers.hasLocalData()) {
+        svg_renderers.setLocalData(new QSvgRenderer(filename));
+    }
+    return svg_renderers.localData();
+}
+
+/* Rasterizes a single resource, suitable for QtConcurrent. */
+class TileRenderer
+{
+public:
+    typedef QImage result_type;
+
+    TileRenderer(const QString &filename, const QVector<QString> &names)
+        : m_filename(filename), m_names(names) { }
+
+    QImage operator()(const Renderer::Tile &tile) const {
+        QImage image(tile.size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        svgRenderer(m_filename)->render(&painter, m_names[tile.resource], image.rect());
+        return image;
+    }
+
+private:
+    const QString m_filename;
+    const QVector<QString> m_names;
+};
+
+Renderer::Renderer(QObject *parent) : QObject(parent), m_tilesize(47),
+    m_overview_tilesize(12), m_streak_grid_count(6), m_rendering(0),
+    m_rendering_prewarm(false), m_requested(0), m_board_width(0), m_board_height(0),
+    m_statistics()
 {
     loadResources();
 
@@ -43,6 +91,17 @@ Renderer::Renderer() : m_tilesize(47), m_overview_tilesize(12),
             << "box" << "cross" << "highlight" << "streak1"
             << "streak2" << "divider" << "overview_box"
             << "overview_cross";
+
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(renderFinished()));
+
+    m_prewarm_timer.setSingleShot(true);
+    m_prewarm_timer.setInterval(PREWARM_DELAY);
+    connect(&m_prewarm_timer, SIGNAL(timeout()), this, SLOT(prewarm()));
+}
+
+Renderer::~Renderer() {
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
 }
 
 void Renderer::loadResources() {
@@ -70,29 +129,33 @@ void Renderer::loadResources() {
         if (!QFile::exists(filenameSvg)) {
             continue;
         }
-        m_renderer = QSharedPointer<QSvgRenderer>(new QSvgRenderer(filenameSvg));
+        m_filename = filenameSvg;
         return;
     }
 
     throw SystemException("Resources not found");
 }
 
-int Renderer::gridSize(const QSize &size, int board_width, int board_height) const {
-    int grid = size.width() / (board_width + m_streak_grid_count);
+int Renderer::gridSize(const QSize &size, int board_width, int board_height,
+                       int streak_grid_count) {
+    int grid = size.width() / (board_width + streak_grid_count);
 
-    if ((board_height + m_streak_grid_count) * grid > size.height()) {
-        grid = size.height() / (board_height + m_streak_grid_count);
+    if ((board_height + streak_grid_count) * grid > size.height()) {
+        grid = size.height() / (board_height + streak_grid_count);
     }
 
     return grid;
 }
 
-bool Renderer::streaksFit(const QStringList &streaks) const {
-    QFontMetrics fm(m_fonts[Regular]);
+bool Renderer::streaksFit(const QStringList &streaks, int tilesize,
+                          int streak_grid_count) const {
+    QFont font(m_fonts[Regular]);
+    font.setPointSize(fontSize(Regular, tilesize));
+    QFontMetrics fm(font);
 
     /* Subtract a little from real size to account for padding. */
-    const int len = m_streak_grid_count * m_tilesize - m_tilesize;
-    const int limit = 8 * m_tilesize;
+    const int len = streak_grid_count * tilesize - tilesize;
+    const int limit = 8 * tilesize;
     const QRect limrect(0, 0, limit, limit);
 
     foreach (const QString &str, streaks) {
@@ -107,34 +170,66 @@ bool Renderer::streaksFit(const QStringList &streaks) const {
     return true;
 }
 
-void Renderer::setSize(const QSize &size, int board_width, int board_height,
-                       const QStringList &streaks) {
-    if (board_width < 0 || board_height < 0) {
-        throw OutOfBoundsException();
-    }
-
+quint64 Renderer::layout(const QSize &size, int board_width, int board_height,
+                         const QStringList &streaks) const {
     /* Calculate the tile size, given the window size, the board dimensions,
        and the list of streak strings. The tile size must be the largest value
        such that all streaks will still fit into
-       m_streak_grid_count * m_tilesize.
+       streak_grid_count * tilesize.
 
        Start with the default minimum grid size, and keep
        recalculating the tile size until all streaks fit. */
 
-    m_streak_grid_count = MIN_STREAK_COUNT - 1;
+    int streak_grid_count = MIN_STREAK_COUNT - 1;
+    int tilesize;
     do {
-        m_streak_grid_count++;
-        m_tilesize = gridSize(size, board_width, board_height);
-        setFontSize();
-    } while (!streaksFit(streaks));
+        streak_grid_count++;
+        tilesize = gridSize(size, board_width, board_height, streak_grid_count);
+    } while (tilesize > 0 && !streaksFit(streaks, tilesize, streak_grid_count));
 
     /* the overview is a square area at the top left of the field with dimensions
        getXOffset() x getYOffset(). using the same logic as for calculating the
        main tilesize, get the overview tilesize such that the entire board fits */
 
     const int buffer = 15;
-    QSize overview_size(getXOffset() - buffer, getYOffset() - buffer);
-    m_overview_tilesize = gridSize(overview_size, board_width, board_height);
+    const int offset = streak_grid_count * tilesize;
+    QSize overview_size(offset - buffer, offset - buffer);
+    const int overview_tilesize = gridSize(overview_size, board_width, board_height,
+                                           streak_grid_count);
+
+    return key(qMax(tilesize, 0), qMax(overview_tilesize, 0), streak_grid_count);
+}
+
+void Renderer::setSize(const QSize &size, int board_width, int board_height,
+                       const QStringList &streaks) {
+    if (board_width < 0 || board_height < 0) {
+        throw OutOfBoundsException();
+    }
+
+    const quint64 key = layout(size, board_width, board_height, streaks);
+    m_tilesize = key >> 32;
+    m_overview_tilesize = (key >> 16) & 0xffff;
+    m_streak_grid_count = key & 0xffff;
+    setFontSize();
+
+    m_tile_set.clear();
+
+    m_size = size;
+    m_board_width = board_width;
+    m_board_height = board_height;
+    m_streaks = streaks;
+    m_prewarm.clear();
+    m_prewarm_timer.start();
+}
+
+void Renderer::setFullScreenSize(const QSize &size) {
+    m_fullscreen_size = size;
+}
+
+Renderer::CacheStatistics Renderer::cacheStatistics() const {
+    CacheStatistics statistics = m_statistics;
+    statistics.tile_sets = m_tile_sets.size();
+    return statistics;
 }
 
 int Renderer::getOverviewTilesize() const {
@@ -147,54 +242,364 @@ const QFont &Renderer::getFont(enum FontSize size) const {
 
 #define MIN_FONT_SIZE (5)
 
-void Renderer::setFontSize() {
-    int size;
-
-    size = (m_tilesize - 10) * 0.5 + 5;
-    m_fonts[Regular].setPointSize(qMax(MIN_FONT_SIZE, size));
+int Renderer::fontSize(enum FontSize size, int tilesize) {
+    switch (size) {
+    case Large: return qMax(MIN_FONT_SIZE, (int)((tilesize - 10) * 0.75 + 7));
+    default: return qMax(MIN_FONT_SIZE, (int)((tilesize - 10) * 0.5 + 5));
+    }
+}
 
-    size = (m_tilesize - 10) * 0.75 + 7;
-    m_fonts[Large].setPointSize(qMax(MIN_FONT_SIZE, size));
+void Renderer::setFontSize() {
+    m_fonts[Regular].setPointSize(fontSize(Regular, m_tilesize));
+    m_fonts[Large].setPointSize(fontSize(Large, m_tilesize));
 }
 
 Renderer *Renderer::instance() {
-    static Renderer instance;
-    return &instance;
+    /* Owned by the application so that pixmaps are released while the
+       window system is still around. */
+    static QPointer<Renderer> renderer;
+    if (!renderer) {
+        renderer = new Renderer(QCoreApplication::instance());
+    }
+    return renderer;
 }
 
 QPixmap Renderer::getPixmap(Renderer::Resource resource) const {
-    switch (resource) {
-    case Background: return getCachedPixmap(resource, 1200, 1920);
-    case Streak1:
-    case Streak2: return getCachedPixmap(resource, m_tilesize, m_tilesize * m_streak_grid_count);
-    case OverviewBox:
-    case OverviewCross: return getCachedPixmap(resource, m_overview_tilesize, m_overview_tilesize);
-    default: return getCachedPixmap(resource, m_tilesize, m_tilesize);
+    if (resource == Background) {
+        return background();
     }
+    return tileSet().tiles[resource];
 }
 
-QPixmap Renderer::getCachedPixmap(Renderer::Resource resource, int h, int w) const
-{
+QPixmap Renderer::background() const {
     /* Special case for custom background. */
-    if (resource == Background) {
-        if (Settings::instance()->customBgEnabled()) {
-            return QPixmap(Settings::instance()->customBgPath());
+    if (Settings::instance()->customBgEnabled()) {
+        return QPixmap(Settings::instance()->customBgPath());
+    }
+
+    if (m_background.isNull()) {
+        m_background = QPixmap(1920, 1200);
+        m_background.fill(Qt::transparent);
+        QPainter painter(&m_background);
+        svgRenderer(m_filename)->render(&painter, m_names[Background], m_background.rect());
+    }
+    return m_background;
+}
+
+quint64 Renderer::key(int tilesize, int overview_tilesize, int streak_grid_count) {
+    return ((quint64)tilesize << 32) | ((quint64)overview_tilesize << 16)
+            | (quint64)streak_grid_count;
+}
+
+quint64 Renderer::key() const {
+    return key(m_tilesize, m_overview_tilesize, m_streak_grid_count);
+}
+
+const Renderer::TileSet &Renderer::tileSet() const {
+    if (m_tile_set) {
+        return *m_tile_set;
+    }
+
+    const quint64 key = this->key();
+
+    const int i = cachedTileSet(key);
+    if (i != -1) {
+        m_tile_set = m_tile_sets.takeAt(i);
+        m_tile_sets.prepend(m_tile_set);
+        m_statistics.hits++;
+        if (m_tile_set->prewarmed) {
+            m_tile_set->prewarmed = false;
+            m_statistics.prewarm_hits++;
         }
+        return *m_tile_set;
     }
 
-    QString key = QString("%1:%2x%3").arg(m_names[resource]).arg(w).arg(h);
+    m_statistics.misses++;
+
+    /* Without anything to scale, e.g. on startup, render right away.
+       Otherwise make do with the most recently used tiles until the
+       workers are done. */
+
+    if (m_tile_sets.isEmpty()) {
+        m_tile_set = renderTileSet(key);
+        cacheTileSet(m_tile_set);
+    } else {
+        m_tile_set = scaleTileSet(*m_tile_sets.first(), key);
+        requestTileSet(key);
+    }
+
+    return *m_tile_set;
+}
+
+int Renderer::cachedTileSet(quint64 key) const {
+    for (int i = 0; i < m_tile_sets.size(); i++) {
+        if (m_tile_sets[i]->key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Renderer::cacheTileSet(QSharedPointer<TileSet> set) const {
+    /* Predictions may be wrong, tiles rendered ahead of time come after
+       those which have actually been used. */
+
+    if (set->prewarmed) {
+        m_tile_sets.append(set);
+        m_statistics.prewarmed++;
+    } else {
+        m_tile_sets.prepend(set);
+    }
+    m_statistics.bytes += set->bytes;
+
+    evictTileSets();
+}
+
+void Renderer::evictTileSets() const {
+    /* Evict the least recently used tile sets until the cache fits its
+       budget. The set in use stays, however large it is. */
+
+    for (int i = m_tile_sets.size() - 1;
+         i >= 0 && m_statistics.bytes > TILE_CACHE_BYTES; i--) {
+        if (m_tile_sets[i] == m_tile_set) {
+            continue;
+        }
+        m_statistics.bytes -= m_tile_sets[i]->bytes;
+        m_statistics.evictions++;
+        m_tile_sets.removeAt(i);
+    }
+}
+
+QSharedPointer<Renderer::TileSet> Renderer::layoutTileSet(quint64 key) {
+    QSharedPointer<TileSet> set(new TileSet);
+    set->key = key;
+    set->provisional = false;
+    set->prewarmed = false;
+
+    const int tilesize = key >> 32;
+    const int overview_tilesize = (key >> 16) & 0xffff;
+    const int streak_grid_count = key & 0xffff;
+
+    qint64 area = 0;
+    for (int i = 0; i < ResourceCount; i++) {
+        QSize size;
+        switch (i) {
+        case Background: break;
+        case Streak1:
+        case Streak2: size = QSize(tilesize * streak_grid_count, tilesize); break;
+        case OverviewBox:
+        case OverviewCross: size = QSize(overview_tilesize, overview_tilesize); break;
+        default: size = QSize(tilesize, tilesize);
+        }
 
-    QPixmap pixmap;
-    if (!QPixmapCache::find(key, pixmap)) {
-        pixmap = QPixmap(w, h);
-        pixmap.fill(Qt::transparent);
-        QPainter painter(&pixmap);
-        m_renderer->render(&painter, m_names[resource], QRectF(0, 0, w, h));
-        painter.end();
-        QPixmapCache::insert(key, pixmap);
+        set->sizes[i] = size.expandedTo(QSize(0, 0));
+        area += (qint64)set->sizes[i].width() * set->sizes[i].height();
     }
 
-    return pixmap;
+    /* 32 bits per pixel. */
+
+    set->bytes = area * 4;
+
+    return set;
+}
+
+QSharedPointer<Renderer::TileSet> Renderer::renderTileSet(quint64 key) const {
+    QSharedPointer<TileSet> set = layoutTileSet(key);
+
+    QList<Tile> tiles;
+    QList<QImage> images;
+    TileRenderer render(m_filename, m_names);
+    for (int i = 0; i < ResourceCount; i++) {
+        if (!set->sizes[i].isEmpty()) {
+            const Tile tile = { i, set->sizes[i] };
+            tiles << tile;
+            images << render(tile);
+        }
+    }
+
+    assembleTileSet(set.data(), tiles, images);
+    return set;
+}
+
+QSharedPointer<Renderer::TileSet> Renderer::scaleTileSet(const TileSet &from, quint64 key) const {
+    QSharedPointer<TileSet> set = layoutTileSet(key);
+    set->provisional = true;
+
+    for (int i = 0; i < ResourceCount; i++) {
+        const QSize size = set->sizes[i];
+        if (size.isEmpty()) {
+            continue;
+        }
+        if (from.tiles[i].isNull()) {
+            set->tiles[i] = QPixmap(size);
+            set->tiles[i].fill(Qt::transparent);
+        } else {
+            set->tiles[i] = from.tiles[i].scaled(size, Qt::IgnoreAspectRatio,
+                                                 Qt::SmoothTransformation);
+        }
+    }
+
+    return set;
+}
+
+void Renderer::assembleTileSet(TileSet *set, const QList<Tile> &tiles,
+                               const QList<QImage> &images) const {
+    /* QPixmap may only be used on the GUI thread, so workers hand in
+       images which are converted here. */
+
+    for (int i = 0; i < tiles.size() && i < images.size(); i++) {
+        set->tiles[tiles[i].resource] = QPixmap::fromImage(images[i]);
+    }
+}
+
+void Renderer::requestTileSet(quint64 key) const {
+    /* While resizing, the size changes faster than tiles can be rendered.
+       Only one tile set is rendered at a time, the workers then continue with
+       the latest size requested in the meantime. */
+
+    m_requested = key;
+    if (!m_watcher.isRunning()) {
+        startRendering(key, false);
+    }
+}
+
+void Renderer::renderNext() const {
+    if (m_requested != 0) {
+        if (cachedTileSet(m_requested) == -1) {
+            startRendering(m_requested, false);
+            return;
+        }
+        m_requested = 0;
+    }
+
+    /* Predictions are only rendered while they fit into the cache without
+       evicting anything. */
+
+    while (!m_prewarm.isEmpty()) {
+        const quint64 key = m_prewarm.takeFirst();
+        if (cachedTileSet(key) != -1) {
+            continue;
+        }
+        if (m_statistics.bytes + layoutTileSet(key)->bytes > TILE_CACHE_BYTES) {
+            m_prewarm.clear();
+            break;
+        }
+        startRendering(key, true);
+        return;
+    }
+}
+
+void Renderer::startRendering(quint64 key, bool prewarm) const {
+    const QSharedPointer<TileSet> set = layoutTileSet(key);
+
+    m_rendering = key;
+    m_rendering_prewarm = prewarm;
+    m_rendering_tiles.clear();
+    for (int i = 0; i < ResourceCount; i++) {
+        if (!set->sizes[i].isEmpty()) {
+            const Tile tile = { i, set->sizes[i] };
+            m_rendering_tiles << tile;
+        }
+    }
+
+    m_watcher.setFuture(QtConcurrent::mapped(m_rendering_tiles,
+                                             TileRenderer(m_filename, m_names)));
+}
+
+void Renderer::renderFinished() {
+    if (m_watcher.isCanceled()) {
+        return;
+    }
+
+    if (m_rendering == m_requested) {
+        m_requested = 0;
+    }
+
+    QSharedPointer<TileSet> set = layoutTileSet(m_rendering);
+    assembleTileSet(set.data(), m_rendering_tiles, m_watcher.future().results());
+
+    const bool current = (m_tile_set && m_tile_set->provisional && m_tile_set->key == set->key);
+    /* Sizes requested while resizing and superseded before they were done
+       have been used, only predictions count as rendered ahead of time. */
+    set->prewarmed = m_rendering_prewarm && !current;
+    if (current) {
+        m_tile_set = set;
+    }
+    cacheTileSet(set);
+
+    if (current) {
+        emit tilesChanged();
+    }
+
+    renderNext();
+}
+
+void Renderer::prewarm() {
+    m_prewarm = predictKeys();
+    if (!m_watcher.isRunning()) {
+        renderNext();
+    }
+}
+
+/* Approximates the streak texts of a random board, which have about one
+   clue per three cells. */
+static QStringList typicalStreaks(int board_width, int board_height) {
+    QStringList row, col;
+    for (int i = 0; i < (board_width + 2) / 3; i++) {
+        row << "2";
+    }
+    for (int i = 0; i < (board_height + 2) / 3; i++) {
+        col << "2";
+    }
+    return QStringList() << row.join(" ") << col.join("\n");
+}
+
+QList<quint64> Renderer::predictKeys() const {
+    QList<quint64> keys;
+    if (m_size.isEmpty() || m_board_width == 0 || m_board_height == 0) {
+        return keys;
+    }
+
+    /* The window growing or shrinking a little. */
+
+    const int deltas[] = { 1, -1, 2, -2 };
+    for (int i = 0; i < (int)(sizeof(deltas) / sizeof(deltas[0])); i++) {
+        const int tilesize = m_tilesize + deltas[i];
+        if (tilesize <= 0) {
+            continue;
+        }
+        const QSize size((m_board_width + m_streak_grid_count) * tilesize,
+                         (m_board_height + m_streak_grid_count) * tilesize);
+        keys << layout(size, m_board_width, m_board_height, m_streaks);
+    }
+
+    /* The window in fullscreen mode. */
+
+    if (!m_fullscreen_size.isEmpty()) {
+        keys << layout(m_fullscreen_size, m_board_width, m_board_height, m_streaks);
+    }
+
+    /* A random game of each standard difficulty level. */
+
+    const KgDifficultyLevel::StandardLevel levels[] = {
+        KgDifficultyLevel::Easy, KgDifficultyLevel::Medium, KgDifficultyLevel::Hard
+    };
+    for (int i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++) {
+        const QSize board = KdeAdapter::boardSize(levels[i]);
+        keys << layout(m_size, board.width(), board.height(),
+                       typicalStreaks(board.width(), board.height()));
+    }
+
+    /* Zero sized tiles need not be rendered. */
+
+    const quint64 current = key();
+    QList<quint64> predicted;
+    foreach (quint64 k, keys) {
+        if (k != current && (k >> 32) != 0 && !predicted.contains(k)) {
+            predicted << k;
+        }
+    }
+    return predicted;
 }
 
 int Renderer::getTilesize() const {
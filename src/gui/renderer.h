@@ -20,14 +20,21 @@
 #define RENDERER_H
 
 #include <QFont>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QList>
+#include <QObject>
 #include <QPixmap>
+#include <QSize>
 #include <QString>
+#include <QStringList>
+#include <QTimer>
 #include <QVector>
-#include <QtSvg/QSvgRenderer>
 #include <QSharedPointer>
 
-class Renderer
+class Renderer : public QObject
 {
+    Q_OBJECT
 public:
     enum Resource {
         Transparent = 0,
@@ -40,7 +47,8 @@ public:
         Streak2,
         Divider,
         OverviewBox,
-        OverviewCross
+        OverviewCross,
+        ResourceCount /* not a resource */
     };
 
     enum FontSize {
@@ -52,6 +60,19 @@ public:
         FontSizeLength
     };
 
+    /* counters of the tile cache, for tuning and debugging */
+    struct CacheStatistics {
+        int hits;
+        int misses;
+        /* tile sets rendered ahead of time, and how many of them were used */
+        int prewarmed;
+        int prewarm_hits;
+        int evictions;
+        /* the number of cached tile sets and their size in bytes */
+        int tile_sets;
+        qint64 bytes;
+    };
+
     static Renderer *instance();
 
     /* returns the pixmap representing the given resource at the
@@ -74,21 +95,90 @@ public:
     void setSize(const QSize &size, int board_width, int board_height,
                  const QStringList &streaks);
 
+    /* sets the view size the window would have in fullscreen mode,
+       which is one of the sizes rendered ahead of time */
+    void setFullScreenSize(const QSize &size);
+
+    CacheStatistics cacheStatistics() const;
+
+signals:
+    /* emitted once crisp tiles replace the scaled ones handed out
+       by getPixmap() since the last setSize() */
+    void tilesChanged();
+
+private slots:
+    void renderFinished();
+    void prewarm();
+
 private:
-    Renderer();
+    explicit Renderer(QObject *parent);
+    ~Renderer();
+
+    /* A pixmap per resource except the background, indexed by Resource,
+       for one combination of tile size, overview tile size and streak
+       grid count. Provisional sets hold tiles scaled from another size
+       while the real ones are rendered. */
+    struct TileSet {
+        quint64 key;
+        bool provisional;
+        /* rendered ahead of time and not used yet */
+        bool prewarmed;
+        qint64 bytes;
+        QSize sizes[ResourceCount];
+        QPixmap tiles[ResourceCount];
+    };
 
-    QPixmap getCachedPixmap(Renderer::Resource resource, int h, int w) const;
+    /* a resource to be rasterized by a worker thread */
+    struct Tile {
+        int resource;
+        QSize size;
+    };
+    friend class TileRenderer;
+
+    quint64 key() const;
+    static quint64 key(int tilesize, int overview_tilesize, int streak_grid_count);
+    static QSharedPointer<TileSet> layoutTileSet(quint64 key);
+
+    /* returns the key of the sizes setSize() would choose */
+    quint64 layout(const QSize &size, int board_width, int board_height,
+                   const QStringList &streaks) const;
+
+    /* returns the keys of the sizes likely to be needed next */
+    QList<quint64> predictKeys() const;
+
+    /* returns the tiles for the current sizes. If they are not cached,
+       rendering is started in the background and a provisional set
+       is returned meanwhile. */
+    const TileSet &tileSet() const;
+    int cachedTileSet(quint64 key) const;
+    /* adds a tile set to the cache, as the most recently used one unless it
+       has only been rendered ahead of time */
+    void cacheTileSet(QSharedPointer<TileSet> set) const;
+    void evictTileSets() const;
+    QSharedPointer<TileSet> renderTileSet(quint64 key) const;
+    QSharedPointer<TileSet> scaleTileSet(const TileSet &from, quint64 key) const;
+    void assembleTileSet(TileSet *set, const QList<Tile> &tiles,
+                         const QList<QImage> &images) const;
+    void requestTileSet(quint64 key) const;
+    /* renders the requested tile set, or else the next predicted one */
+    void renderNext() const;
+    /* prewarm is set if key is a prediction rather than a size in use */
+    void startRendering(quint64 key, bool prewarm) const;
+    QPixmap background() const;
     void loadResources();
 
     /* calculates the largest tile size such that the entire game area fits
       into the provided window size */
-    int gridSize(const QSize &size, int board_width, int board_height) const;
+    static int gridSize(const QSize &size, int board_width, int board_height,
+                        int streak_grid_count);
 
-    /* Returns true if the given streaks fit into the current area specified
-       by m_streak_count and m_tilesize. */
-    bool streaksFit(const QStringList &streaks) const;
+    /* Returns true if the given streaks fit into the area specified
+       by streak_grid_count and tilesize. */
+    bool streaksFit(const QStringList &streaks, int tilesize,
+                    int streak_grid_count) const;
 
     void setFontSize();
+    static int fontSize(enum FontSize size, int tilesize);
 
 private:
 
@@ -98,9 +188,34 @@ private:
 
     QFont m_fonts[FontSizeLength];
 
-    QSharedPointer<QSvgRenderer> m_renderer;
+    /* the theme; each thread rasterizing it uses its own QSvgRenderer */
+    QString m_filename;
 
     QVector<QString> m_names;
+
+    /* the tiles for the current sizes, and recently used ones */
+    mutable QSharedPointer<TileSet> m_tile_set;
+    mutable QList<QSharedPointer<TileSet> > m_tile_sets;
+    mutable QPixmap m_background;
+
+    /* the tile set being rasterized, and the one wanted next */
+    mutable QFutureWatcher<QImage> m_watcher;
+    mutable QList<Tile> m_rendering_tiles;
+    mutable quint64 m_rendering;
+    mutable bool m_rendering_prewarm;
+    mutable quint64 m_requested;
+
+    /* the arguments of the last setSize(), from which sizes are predicted
+       once resizing has settled */
+    QSize m_size;
+    QSize m_fullscreen_size;
+    int m_board_width;
+    int m_board_height;
+    QStringList m_streaks;
+    QTimer m_prewarm_timer;
+    mutable QList<quint64> m_prewarm;
+
+    mutable CacheStatistics m_statistics;
 };
 
 #endif // RENDERER_H
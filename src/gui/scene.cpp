@@ -19,6 +19,7 @@
 #include "scene.h"
 
 #include "src/constants.h"
+#include "src/logic/levelmetadata.h"
 
 Scene::Scene(QSharedPointer<Picmi> game, QObject *parent) :
     QGraphicsScene(parent), m_game(game), m_position(0, 0)
@@ -78,6 +79,11 @@ void Scene::loadOverView() {
 }
 
 void Scene::loadStreaks() {
+    /* Only the widest and tallest streak texts are measured when sizing the
+       streak areas, the others fit if these do. */
+
+    const LevelMetadata metadata(*m_game->getBoardMap(), false);
+
     for (int x = 0; x < m_game->width(); x++) {
         StreakVBackgroundItem *p = new StreakVBackgroundItem((x % 2) ? Renderer::Streak1 : Renderer::Streak2, x);
         m_items.push_back(p);
@@ -88,7 +94,9 @@ void Scene::loadStreaks() {
         m_col_streaks.push_back(q);
         m_group->addToGroup(q);
 
-        m_streak_strings.append(q->toPlainText());
+        if (x == metadata.tall_col) {
+            m_streak_strings.append(q->toPlainText());
+        }
     }
 
     for (int y = 0; y < m_game->height(); y++) {
@@ -101,7 +109,9 @@ void Scene::loadStreaks() {
         m_row_streaks.push_back(q);
         m_group->addToGroup(q);
 
-        m_streak_strings.append(q->toPlainText());
+        if (y == metadata.wide_row || y == metadata.wide_digit_row) {
+            m_streak_strings.append(q->toPlainText());
+        }
     }
 }
 
@@ -151,6 +161,7 @@ void Scene::init() {
     updateHighlights();
 
     connect(m_game.data(), SIGNAL(gameCompleted()), this, SLOT(onGameCompleted()));
+    connect(Renderer::instance(), SIGNAL(tilesChanged()), this, SLOT(reloadTiles()));
 }
 
 void Scene::refresh() {
@@ -283,3 +294,10 @@ void Scene::resize(const QSize &size) {
         m_items[i]->reload(size);
     }
 }
+
+void Scene::reloadTiles() {
+    const QSize size = sceneRect().size().toSize();
+    for (int i = 0; i < (int)m_items.size(); i++) {
+        m_items[i]->reload(size);
+    }
+}
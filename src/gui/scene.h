@@ -61,6 +61,8 @@ public:
 
 private slots:
     void onGameCompleted();
+    /* sets the crisp tiles once the renderer has them */
+    void reloadTiles();
 
 private:
 
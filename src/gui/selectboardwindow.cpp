@@ -20,21 +20,30 @@
 #include <KConfigGroup>
 #include <KLocalizedString>
 #include <QAbstractTableModel>
+#include <QBitArray>
 #include <QDialogButtonBox>
+#include <QHash>
+#include <QHeaderView>
 #include <QPushButton>
 #include <QVBoxLayout>
-#include <QtAlgorithms>
+#include <QVector>
+#include <algorithm>
 #include <assert.h>
+#include <limits.h>
 
 #include "src/logic/elapsedtime.h"
+#include "src/logic/levelindex.h"
 #include "src/logic/levelloader.h"
 
 static QString diffString(const int difficulty);
 
+/* Levels are stored in the order they were added. m_order refers to all
+   of them in sort order, the rows show those matching the filter in the
+   same order. Sorting and filtering rearrange only these permutations. */
 class LevelTableModel : public QAbstractTableModel
 {
 public:
-    LevelTableModel(QList<QSharedPointer<Level> > &levels, QObject * parent = 0);
+    explicit LevelTableModel(QObject *parent = 0);
 
     enum Columns {
         Name,
@@ -49,21 +58,120 @@ public:
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
     QVariant data(const QModelIndex &index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+
+    /* sorts by column. ties are ordered by solved state (descending) and
+       name, which gives the default order when sorting by difficulty.
+       levels added later are sorted in as well */
     void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
 
+    /* shows only the levels matching query, see LevelIndex::match() */
+    void setFilter(const QString &query);
+
+    /* returns the level shown in row, or a null pointer */
+    QSharedPointer<Level> level(int row) const;
+
+    /* returns the row showing level, or -1 */
+    int row(const QSharedPointer<Level> &level) const;
+
+    /* adds levels to the table */
+    void appendLevels(const QList<QSharedPointer<Level> > &levels);
+
+    /* removes the rows of levels */
+    void removeLevels(const QList<QSharedPointer<Level> > &levels);
+
+    /* updates the rows of levels after their solved state has changed */
+    void updateLevels(const QList<QSharedPointer<Level> > &levels);
+
+private:
+    /* A level and its sort keys. Display strings are created once the row
+       is shown. */
+    struct Entry {
+        QSharedPointer<Level> level;
+        int id;         /* in m_level_index */
+        QString levelset;
+        int difficulty;
+        int size;
+        int width;
+        int solved;     /* solved time, -1 if unsolved */
+
+        mutable QString display[ColumnCount];
+        mutable bool materialised;
+    };
+
+    /* Consecutive rows removed or inserted by refilter(). */
+    struct Run {
+        int row, count;
+        bool insert;
+    };
+
+    class RowLessThan;
+
+    static void updateKeys(Entry &entry);
+    static void materialise(const Entry &entry);
+    static int compare(int column, const Entry &lhs, const Entry &rhs);
+
+    /* sorts m_order and the rows without notifying views */
+    void sortRows();
+
+    /* rebuilds m_rows from m_visible */
+    void updateRows();
+
+    /* shows the levels in m_matches, notifying views of the removed and
+       inserted rows */
+    void refilter();
+
+    QVector<Entry> m_entries;
+    QVector<int> m_order;   /* sort position -> entry */
+    QVector<int> m_visible; /* row -> entry */
+    QVector<int> m_rows;    /* entry -> row, -1 if filtered out */
+    QHash<const Level *, int> m_entry_of;   /* level -> entry */
+
+    LevelIndex m_level_index;
+    QString m_filter;
+    QBitArray m_matches;    /* by id */
+
+    int m_sort_column;
+    Qt::SortOrder m_sort_order;
+};
+
+class LevelTableModel::RowLessThan
+{
+public:
+    RowLessThan(const QVector<Entry> &entries, int column, Qt::SortOrder order)
+        : m_entries(entries), m_column(column), m_order(order) { }
+
+    bool operator()(int lhs, int rhs) const {
+        const Entry &l = m_entries[lhs];
+        const Entry &r = m_entries[rhs];
+
+        int c = compare(m_column, l, r);
+        if (m_order == Qt::DescendingOrder) {
+            c = -c;
+        }
+        if (c == 0) {
+            c = -compare(Solved, l, r);
+        }
+        if (c == 0) {
+            c = compare(Name, l, r);
+        }
+        return (c == 0) ? (lhs < rhs) : (c < 0);
+    }
+
 private:
-    QList<QSharedPointer<Level> > &m_levels;
+    const QVector<Entry> &m_entries;
+    const int m_column;
+    const Qt::SortOrder m_order;
 };
 
-LevelTableModel::LevelTableModel(QList<QSharedPointer<Level> > &levels, QObject *parent) :
-    QAbstractTableModel(parent), m_levels(levels)
+LevelTableModel::LevelTableModel(QObject *parent) :
+    QAbstractTableModel(parent), m_sort_column(-1), m_sort_order(Qt::AscendingOrder)
 {
 
 }
 
 int LevelTableModel::rowCount(const QModelIndex &parent) const {
     Q_UNUSED(parent);
-    return m_levels.size();
+    return m_visible.size();
 }
 
 int LevelTableModel::columnCount(const QModelIndex &parent) const {
@@ -80,17 +188,11 @@ QVariant LevelTableModel::data(const QModelIndex &index, int role) const {
         return Qt::AlignCenter;
     }
 
-    QSharedPointer<Level> level= m_levels[index.row()];
-    switch (index.column()) {
-    case Name: return level->visibleName();
-    case LevelSet: return level->levelset();
-    case Difficulty: return diffString(level->difficulty());
-    case Size: return QString("%1x%2").arg(level->width()).arg(level->height());
-    case Solved: return (level->solved()) ? Time(level->solvedTime()).toString() : "-";
-    default: assert(0);
+    const Entry &entry = m_entries[m_visible[index.row()]];
+    if (!entry.materialised) {
+        materialise(entry);
     }
-
-    return QVariant();
+    return entry.display[index.column()];
 }
 
 QVariant LevelTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
@@ -107,56 +209,290 @@ QVariant LevelTableModel::headerData(int section, Qt::Orientation orientation, i
     return QAbstractTableModel::headerData(section, orientation, role);
 }
 
-typedef bool (*LevelComparator)(const QSharedPointer<Level> &,
-                                const QSharedPointer<Level> &);
+void LevelTableModel::updateKeys(Entry &entry) {
+    const Level &level = *entry.level;
+    entry.levelset = level.levelset();
+    entry.difficulty = level.difficulty();
+    entry.size = level.width() * level.height();
+    entry.width = level.width();
+    entry.solved = level.solved() ? level.solvedTime() : -1;
+    entry.materialised = false;
+}
 
-static bool levelLessThan(const QSharedPointer<Level> &lhs,
-                          const QSharedPointer<Level> &rhs) {
-    return lhs->name() < rhs->name();
+void LevelTableModel::materialise(const Entry &entry) {
+    const Level &level = *entry.level;
+    entry.display[Name] = level.visibleName();
+    entry.display[LevelSet] = level.levelset();
+    entry.display[Difficulty] = diffString(level.difficulty());
+    entry.display[Size] = QString("%1x%2").arg(level.width()).arg(level.height());
+    entry.display[Solved] = level.solved() ? Time(level.solvedTime()).toString() : "-";
+    entry.materialised = true;
 }
 
-static bool levelGreaterThan(const QSharedPointer<Level> &lhs,
-                             const QSharedPointer<Level> &rhs) {
-    return levelLessThan(rhs, lhs);
+int LevelTableModel::compare(int column, const Entry &lhs, const Entry &rhs) {
+    switch (column) {
+    case Name: return lhs.level->sortKey().compare(rhs.level->sortKey());
+    case LevelSet: return lhs.levelset.compare(rhs.levelset);
+    case Difficulty: return lhs.difficulty - rhs.difficulty;
+    case Size: return (lhs.size != rhs.size) ? lhs.size - rhs.size : lhs.width - rhs.width;
+    case Solved: return (lhs.solved < rhs.solved) ? -1 : (lhs.solved > rhs.solved);
+    default: assert(0);
+    }
+    return 0;
 }
 
-static bool diffLessThan(const QSharedPointer<Level> &lhs,
-                         const QSharedPointer<Level> &rhs) {
-    return lhs->difficulty() < rhs->difficulty();
+void LevelTableModel::sort(int column, Qt::SortOrder order) {
+    m_sort_column = column;
+    m_sort_order = order;
+
+    /* Persistent indexes (e.g. the selection) keep pointing to their
+       levels. */
+
+    emit layoutAboutToBeChanged();
+
+    const QModelIndexList from = persistentIndexList();
+    QVector<int> entries;
+    for (int i = 0; i < from.size(); i++) {
+        entries.append(m_visible[from[i].row()]);
+    }
+
+    sortRows();
+
+    QModelIndexList to;
+    for (int i = 0; i < from.size(); i++) {
+        to.append(index(m_rows[entries[i]], from[i].column()));
+    }
+    changePersistentIndexList(from, to);
+
+    emit layoutChanged();
 }
 
-static bool diffGreaterThan(const QSharedPointer<Level> &lhs,
-                            const QSharedPointer<Level> &rhs) {
-    return diffLessThan(rhs, lhs);
+void LevelTableModel::sortRows() {
+    if (m_sort_column >= 0) {
+        std::sort(m_order.begin(), m_order.end(),
+                  RowLessThan(m_entries, m_sort_column, m_sort_order));
+    }
+
+    m_visible.clear();
+    for (int i = 0; i < m_order.size(); i++) {
+        if (m_rows[m_order[i]] >= 0) {
+            m_visible.append(m_order[i]);
+        }
+    }
+    updateRows();
 }
 
-static bool solvedLessThan(const QSharedPointer<Level> &lhs,
-                           const QSharedPointer<Level> &rhs) {
-    if (!lhs->solved() && !rhs->solved()) {
-        return false;
-    } else if (!lhs->solved() || !rhs->solved()) {
-        return lhs->solved();
-    } else {
-        return (lhs->solvedTime() < rhs->solvedTime());
+void LevelTableModel::updateRows() {
+    m_rows.fill(-1, m_entries.size());
+    for (int i = 0; i < m_visible.size(); i++) {
+        m_rows[m_visible[i]] = i;
     }
 }
 
-static bool solvedGreaterThan(const QSharedPointer<Level> &lhs,
-                              const QSharedPointer<Level> &rhs) {
-    return solvedLessThan(rhs, lhs);
+void LevelTableModel::refilter() {
+    /* The old and the new rows both follow m_order. A single walk over it
+       yields the runs of rows to remove and insert, in an order in which
+       they can be applied one after the other. */
+
+    QVector<int> visible;
+    QVector<Run> runs;
+    for (int i = 0; i < m_order.size(); i++) {
+        const int entry = m_order[i];
+        const bool shown = (m_rows[entry] >= 0);
+        const bool matches = m_matches.testBit(m_entries[entry].id);
+
+        if (shown == matches) {
+            if (shown) {
+                visible.append(entry);
+            }
+            continue;
+        }
+
+        const int row = visible.size();
+        Run *last = runs.isEmpty() ? 0 : &runs.last();
+        if (matches) {
+            if (last && last->insert && last->row + last->count == row) {
+                last->count++;
+            } else {
+                Run run = { row, 1, true };
+                runs.append(run);
+            }
+            visible.append(entry);
+        } else {
+            if (last && !last->insert && last->row == row) {
+                last->count++;
+            } else {
+                Run run = { row, 1, false };
+                runs.append(run);
+            }
+        }
+    }
+
+    if (runs.isEmpty()) {
+        return;
+    }
+
+    /* Views handle a few large runs well, but not thousands of single
+       rows. */
+
+    if (runs.size() > 64) {
+        beginResetModel();
+        m_visible = visible;
+        updateRows();
+        endResetModel();
+        return;
+    }
+
+    for (int i = 0; i < runs.size(); i++) {
+        const Run &run = runs[i];
+        if (run.insert) {
+            beginInsertRows(QModelIndex(), run.row, run.row + run.count - 1);
+            m_visible.insert(run.row, run.count, -1);
+            for (int j = run.row; j < run.row + run.count; j++) {
+                m_visible[j] = visible[j];
+            }
+            endInsertRows();
+        } else {
+            beginRemoveRows(QModelIndex(), run.row, run.row + run.count - 1);
+            m_visible.remove(run.row, run.count);
+            endRemoveRows();
+        }
+    }
+
+    Q_ASSERT(m_visible == visible);
+    updateRows();
 }
 
-void LevelTableModel::sort(int column, Qt::SortOrder order) {
-    LevelComparator cmp = NULL;
-    switch (column) {
-    case Name: cmp = (order == Qt::AscendingOrder) ? levelLessThan : levelGreaterThan; break;
-    case Difficulty: cmp = (order == Qt::AscendingOrder) ? diffLessThan : diffGreaterThan; break;
-    case Solved: cmp = (order == Qt::AscendingOrder) ? solvedLessThan : solvedGreaterThan; break;
-    default: assert(0);
+void LevelTableModel::setFilter(const QString &query) {
+    m_filter = query;
+    m_matches = m_level_index.match(m_filter);
+    refilter();
+}
+
+QSharedPointer<Level> LevelTableModel::level(int row) const {
+    if (row < 0 || row >= m_visible.size()) {
+        return QSharedPointer<Level>();
+    }
+    return m_entries[m_visible[row]].level;
+}
+
+int LevelTableModel::row(const QSharedPointer<Level> &level) const {
+    const int entry = m_entry_of.value(level.data(), -1);
+    return (entry < 0) ? -1 : m_rows[entry];
+}
+
+void LevelTableModel::appendLevels(const QList<QSharedPointer<Level> > &levels) {
+    if (levels.isEmpty()) {
+        return;
+    }
+
+    /* New levels are sorted in while hidden, which leaves the order of the
+       existing rows unchanged, and are then shown if they match. */
+
+    const QVector<int> ids = m_level_index.insert(levels);
+    for (int i = 0; i < levels.size(); i++) {
+        Entry entry;
+        entry.level = levels[i];
+        entry.id = ids[i];
+        updateKeys(entry);
+
+        m_entry_of.insert(levels[i].data(), m_entries.size());
+        m_order.append(m_entries.size());
+        m_rows.append(-1);
+        m_entries.append(entry);
+    }
+    sortRows();
+
+    m_matches = m_level_index.match(m_filter);
+    refilter();
+}
+
+void LevelTableModel::removeLevels(const QList<QSharedPointer<Level> > &levels) {
+    QVector<int> ids;
+    QVector<bool> removed(m_entries.size(), false);
+    for (int i = 0; i < levels.size(); i++) {
+        const int entry = m_entry_of.value(levels[i].data(), -1);
+        if (entry >= 0 && !removed[entry]) {
+            removed[entry] = true;
+            ids.append(m_entries[entry].id);
+        }
+    }
+
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    /* Hide the removed levels first, then compact the entries. */
+
+    m_level_index.remove(ids);
+    m_matches = m_level_index.match(m_filter);
+    refilter();
+
+    QVector<int> renumbered(m_entries.size(), -1);
+    int n = 0;
+    for (int i = 0; i < m_entries.size(); i++) {
+        if (!removed[i]) {
+            renumbered[i] = n;
+            m_entries[n++] = m_entries[i];
+        }
     }
+    m_entries.resize(n);
 
-    qStableSort(m_levels.begin(), m_levels.end(), cmp);
-    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() -1));
+    QVector<int> order;
+    for (int i = 0; i < m_order.size(); i++) {
+        if (renumbered[m_order[i]] >= 0) {
+            order.append(renumbered[m_order[i]]);
+        }
+    }
+    m_order = order;
+
+    for (int i = 0; i < m_visible.size(); i++) {
+        m_visible[i] = renumbered[m_visible[i]];
+    }
+
+    m_entry_of.clear();
+    for (int i = 0; i < m_entries.size(); i++) {
+        m_entry_of.insert(m_entries[i].level.data(), i);
+    }
+    updateRows();
+}
+
+void LevelTableModel::updateLevels(const QList<QSharedPointer<Level> > &levels) {
+    QVector<int> ids;
+    for (int i = 0; i < levels.size(); i++) {
+        const int entry = m_entry_of.value(levels[i].data(), -1);
+        if (entry >= 0) {
+            updateKeys(m_entries[entry]);
+            ids.append(m_entries[entry].id);
+        }
+    }
+
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    /* The solved state decides whether names are searchable and is part of
+       every sort order. */
+
+    m_level_index.update(ids);
+    m_matches = m_level_index.match(m_filter);
+    refilter();
+
+    int first = INT_MAX, last = -1;
+    for (int i = 0; i < levels.size(); i++) {
+        const int row = this->row(levels[i]);
+        if (row >= 0) {
+            first = qMin(first, row);
+            last = qMax(last, row);
+        }
+    }
+    if (last >= 0) {
+        emit dataChanged(index(first, 0), index(last, columnCount() - 1));
+    }
+
+    if (m_sort_column >= 0) {
+        sort(m_sort_column, m_sort_order);
+    }
 }
 
 SelectBoardWindow::SelectBoardWindow(QWidget *parent)
@@ -167,9 +503,10 @@ SelectBoardWindow::SelectBoardWindow(QWidget *parent)
     QVBoxLayout *mainLayout = new QVBoxLayout;
     setLayout(mainLayout);
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
-    QPushButton *okButton = buttonBox->button(QDialogButtonBox::Ok);
-    okButton->setDefault(true);
-    okButton->setShortcut(Qt::CTRL | Qt::Key_Return);
+    m_ok_button = buttonBox->button(QDialogButtonBox::Ok);
+    m_ok_button->setDefault(true);
+    m_ok_button->setShortcut(Qt::CTRL | Qt::Key_Return);
+    m_ok_button->setEnabled(false);
     connect(buttonBox, &QDialogButtonBox::accepted, this, &SelectBoardWindow::accept);
     connect(buttonBox, &QDialogButtonBox::rejected, this, &SelectBoardWindow::reject);
     mainLayout->addWidget(buttonBox);
@@ -180,8 +517,7 @@ SelectBoardWindow::SelectBoardWindow(QWidget *parent)
     mainLayout->addWidget(mainWidget);
     mainLayout->addWidget(buttonBox);
 
-    m_levels = LevelLoader::load();
-    m_model = QSharedPointer<LevelTableModel>(new LevelTableModel(m_levels));
+    m_model = QSharedPointer<LevelTableModel>(new LevelTableModel);
 
     ui->tableView->setUpdatesEnabled(false);
     ui->tableView->setModel(m_model.data());
@@ -195,27 +531,87 @@ SelectBoardWindow::SelectBoardWindow(QWidget *parent)
     ui->tableView->showColumn(LevelTableModel::Difficulty);
     ui->tableView->showColumn(LevelTableModel::Solved);
 
-    ui->tableView->sortByColumn(LevelTableModel::Name, Qt::AscendingOrder);
-    ui->tableView->sortByColumn(LevelTableModel::Solved, Qt::DescendingOrder);
+    /* All rows share one height, which saves the view from measuring
+       each of them. */
+
+    ui->tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+
     ui->tableView->sortByColumn(LevelTableModel::Difficulty, Qt::AscendingOrder);
 
-    ui->tableView->resizeColumnsToContents();
-    ui->tableView->resizeRowsToContents();
+    ui->tableView->setUpdatesEnabled(true);
 
-    if (m_levels.empty()) {
-        okButton->setEnabled(false);
-    } else {
-        resetSelection();
-        connect(ui->tableView->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)),
-                this, SLOT(selectedLevelChanged(QModelIndex,QModelIndex)));
-        connect(m_model.data(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
-                this, SLOT(levelDataChanged(QModelIndex,QModelIndex)));
-        updateDetails(m_levels[0]);
+    connect(ui->tableView->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)),
+            this, SLOT(selectedLevelChanged(QModelIndex,QModelIndex)));
+    connect(m_model.data(), SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+            this, SLOT(levelDataChanged(QModelIndex,QModelIndex)));
+    connect(ui->filterEdit, &QLineEdit::textChanged, this, &SelectBoardWindow::filterChanged);
+
+    /* The library is shared by all dialogs and usually loaded by now.
+       Levels still being parsed are shown as they arrive, and files changed
+       while the dialog is open are reflected as well. */
+
+    m_library = LevelLibrary::instance();
+    connect(m_library, &LevelLibrary::levelsAdded, this, &SelectBoardWindow::levelsAdded);
+    connect(m_library, &LevelLibrary::levelsRemoved, this, &SelectBoardWindow::levelsRemoved);
+    connect(m_library, &LevelLibrary::levelsChanged, this, &SelectBoardWindow::levelsChanged);
+    levelsAdded(m_library->levels());
+}
+
+void SelectBoardWindow::levelsAdded(const QList<QSharedPointer<Level> > &levels) {
+    if (levels.isEmpty()) {
+        return;
+    }
+
+    const bool first = (m_model->rowCount() == 0);
+    const QSharedPointer<Level> selected = selectedBoard();
+
+    ui->tableView->setUpdatesEnabled(false);
+
+    /* The model sorts new levels in and keeps the selection. */
+
+    m_model->appendLevels(levels);
+
+    if (first && m_model->rowCount() > 0) {
+        ui->tableView->resizeColumnsToContents();
+        ui->tableView->verticalHeader()->setDefaultSectionSize(ui->tableView->sizeHintForRow(0));
     }
+    restoreSelection(selected);
 
     ui->tableView->setUpdatesEnabled(true);
 }
 
+void SelectBoardWindow::levelsRemoved(const QList<QSharedPointer<Level> > &levels) {
+    const QSharedPointer<Level> selected = selectedBoard();
+    m_model->removeLevels(levels);
+    restoreSelection(selected);
+}
+
+void SelectBoardWindow::levelsChanged(const QList<QSharedPointer<Level> > &levels) {
+    const QSharedPointer<Level> selected = selectedBoard();
+    m_model->updateLevels(levels);
+    restoreSelection(selected);
+}
+
+void SelectBoardWindow::filterChanged(const QString &text) {
+    const QSharedPointer<Level> selected = selectedBoard();
+    m_model->setFilter(text);
+    restoreSelection(selected);
+}
+
+void SelectBoardWindow::changeEvent(QEvent *event) {
+    /* MainWindow invalidates the cached level names. The order in which
+       windows see the change is unspecified, so refresh afterwards. */
+    if (event->type() == QEvent::LanguageChange) {
+        QMetaObject::invokeMethod(this, "retranslateLevels", Qt::QueuedConnection);
+    }
+    QDialog::changeEvent(event);
+}
+
+void SelectBoardWindow::retranslateLevels() {
+    m_model->updateLevels(m_library->levels());
+    updateDetails(selectedBoard());
+}
+
 void SelectBoardWindow::showEvent(QShowEvent *event) {
     updateDetails(selectedBoard());
     QDialog::showEvent(event);
@@ -232,14 +628,15 @@ SelectBoardWindow::~SelectBoardWindow() {
 
 void SelectBoardWindow::selectedLevelChanged(const QModelIndex &current, const QModelIndex &previous) {
     Q_UNUSED(previous);
-    updateDetails(m_levels[current.row()]);
+    if (current.isValid()) {
+        updateDetails(m_model->level(current.row()));
+    }
 }
 
 void SelectBoardWindow::levelDataChanged(const QModelIndex &topLeft, const
                                          QModelIndex &bottomRight) {
     Q_UNUSED(topLeft);
     Q_UNUSED(bottomRight);
-    resetSelection();
     updateDetails(selectedBoard());
 }
 
@@ -264,6 +661,16 @@ static QString diffString(const int difficulty) {
 }
 
 void SelectBoardWindow::updateDetails(QSharedPointer<Level> level) {
+    if (!level) {
+        ui->labelName->clear();
+        ui->labelAuthor->clear();
+        ui->labelSize->clear();
+        ui->labelDifficulty->clear();
+        ui->labelSolved->clear();
+        ui->labelImage->clear();
+        return;
+    }
+
     ui->labelName->setText(i18n("Name: %1", level->visibleName()));
     ui->labelAuthor->setText(i18n("Author: %1", level->author()));
     ui->labelSize->setText(i18n("Size: %1x%2", level->width(), level->height()));
@@ -271,24 +678,36 @@ void SelectBoardWindow::updateDetails(QSharedPointer<Level> level) {
     if (level->solved()) {
         ui->labelSolved->setText(i18nc("board solve time", "Solved: %1",
                                        Time(level->solvedTime()).toString()));
-        QPixmap scaled = level->preview().scaled(ui->labelImage->size(),
-                                                 Qt::KeepAspectRatio,
-                                                 Qt::FastTransformation);
-        ui->labelImage->setPixmap(scaled);
+        ui->labelImage->setPixmap(level->preview(ui->labelImage->size()));
     } else {
         ui->labelSolved->setText(i18nc("board not solved yet", "Solved: -"));
         ui->labelImage->setText("?");
     }
 }
 
-void SelectBoardWindow::resetSelection() {
-    QModelIndex index = m_model->index(0, 0);
+void SelectBoardWindow::restoreSelection(const QSharedPointer<Level> &level) {
+    /* The selection is lost if the level has been filtered out or removed,
+       or if the model has been reset. */
+
+    if (!selectedBoard()) {
+        const int row = m_model->row(level);
+        selectRow((row >= 0) ? row : 0);
+        updateDetails(selectedBoard());
+    }
+    m_ok_button->setEnabled(!selectedBoard().isNull());
+}
+
+void SelectBoardWindow::selectRow(int row) {
+    QModelIndex index = m_model->index(row, 0);
     QItemSelectionModel::SelectionFlags flags =
             QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows;
     ui->tableView->selectionModel()->select(index, flags);
 }
 
 QSharedPointer<Level> SelectBoardWindow::selectedBoard() const {
-    int index = ui->tableView->selectionModel()->selectedIndexes().at(0).row();
-    return m_levels[index];
+    const QModelIndexList indexes = ui->tableView->selectionModel()->selectedIndexes();
+    if (indexes.isEmpty()) {
+        return QSharedPointer<Level>();
+    }
+    return m_model->level(indexes.at(0).row());
 }
@@ -24,7 +24,9 @@
 #include "ui_selectboardwindow.h"
 
 class Level;
+class LevelLibrary;
 class LevelTableModel;
+class QPushButton;
 
 class SelectBoardWindow : public QDialog
 {
@@ -37,21 +39,29 @@ public:
     QSharedPointer<Level> selectedBoard() const;
 
 protected:
+    void changeEvent(QEvent *event);
     void resizeEvent(QResizeEvent *event);
     void showEvent(QShowEvent *event);
 
 private slots:
     void selectedLevelChanged(const QModelIndex &current, const QModelIndex &previous);
     void levelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void levelsAdded(const QList<QSharedPointer<Level> > &levels);
+    void levelsRemoved(const QList<QSharedPointer<Level> > &levels);
+    void levelsChanged(const QList<QSharedPointer<Level> > &levels);
+    void filterChanged(const QString &text);
+    void retranslateLevels();
 
 private:
     void updateDetails(QSharedPointer<Level> level);
-    void resetSelection();
+    void restoreSelection(const QSharedPointer<Level> &level);
+    void selectRow(int row);
 
     Ui::LevelSelectUi *ui;
+    QPushButton *m_ok_button;
 
-    QList<QSharedPointer<Level> > m_levels;
     QSharedPointer<LevelTableModel> m_model;
+    LevelLibrary *m_library;
 };
 
 #endif
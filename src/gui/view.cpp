@@ -18,6 +18,10 @@
 
 #include "view.h"
 
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWindow>
+
 View::View(QWidget *parent) :
     QGraphicsView(parent)
 {
@@ -31,9 +35,24 @@ void View::resizeEvent(QResizeEvent *event) {
     if (event) {
         QGraphicsView::resizeEvent(event);
     }
+    Renderer::instance()->setFullScreenSize(fullScreenSize());
     m_scene->resize(event->size());
 }
 
+QSize View::fullScreenSize() const {
+    /* In fullscreen mode, the window covers the screen and keeps its
+       menu bar, tool bar and status bar. */
+
+    const QWidget *window = this->window();
+    const QWindow *handle = window->windowHandle();
+    const QScreen *screen = handle ? handle->screen() : QGuiApplication::primaryScreen();
+    if (!screen) {
+        return QSize();
+    }
+
+    return screen->size() - (window->size() - size());
+}
+
 void View::keyPressEvent(QKeyEvent *event) {
     /* make sure all key presses go to the currently selected cell item.
        without this, clicking on other areas of the scene causes cell items
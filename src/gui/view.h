@@ -39,6 +39,9 @@ protected:
     void keyPressEvent(QKeyEvent *event);
 
 private:
+    /* returns the size of the view if the window was in fullscreen mode */
+    QSize fullScreenSize() const;
+
     QSharedPointer<Scene> m_scene;
 };
 
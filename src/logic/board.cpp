@@ -19,8 +19,7 @@
 #include "board.h"
 
 Board::Board(int width, int height)
-    : m_width(width), m_height(height), m_size(width * height),
-      m_state(width * height, Nothing)
+    : m_width(width), m_height(height), m_size(width * height)
 {
 }
 
@@ -34,11 +33,6 @@ void Board::assertInbounds(int x, int y) const {
     }
 }
 
-Board::State Board::get(int x, int y) const {
-    assertInbounds(x, y);
-    return m_state[xy_to_i(x, y)];
-}
-
 int Board::xy_to_i(int x, int y) const {
     return y * m_width + x;
 }
@@ -20,7 +20,6 @@
 #define BOARD_H
 
 #include <QString>
-#include <QVector>
 
 #include "src/outofboundsexception.h"
 
@@ -40,7 +39,7 @@ public:
     virtual ~Board() { }
 
     /* 0 <= x < m_width; 0 <= y < m_height */
-    enum State get(int x, int y) const;
+    virtual enum State get(int x, int y) const = 0;
 
     /* returns whether (x, y) is outside the playing area */
     bool outOfBounds(int x, int y) const;
@@ -58,7 +57,6 @@ protected:
     int i_to_y(int i) const;
 
     const int m_width, m_height, m_size;
-    QVector<enum State> m_state;
 };
 
 #endif // BOARD_H
@@ -20,7 +20,6 @@
 
 #include <qglobal.h>
 #include <QTime>
-#include <QVector>
 
 static int box_count(const QList<Board::State> &data) {
     int count = 0;
@@ -33,17 +32,30 @@ static int box_count(const QList<Board::State> &data) {
 }
 
 BoardMap::BoardMap(int width, int height, double box_ratio) :
-    Board(width, height), m_box_count(width * height * box_ratio)
+    Board(width, height), m_map(width, height), m_box_count(width * height * box_ratio)
 {
     genRandom();
+    computeClues();
 }
 
 BoardMap::BoardMap(int width, int height, const QList<Board::State> &map) :
-    Board(width, height), m_box_count(box_count(map))
+    Board(width, height), m_map(width, height), m_box_count(box_count(map))
 {
     for (int i = 0; i < map.size(); i++) {
-        m_state[i] = map[i];
+        m_map.set(i_to_x(i), i_to_y(i), map[i]);
     }
+    computeClues();
+}
+
+BoardMap::BoardMap(const PackedMap &map) :
+    Board(map.width(), map.height()), m_map(map), m_box_count(map.boxCount())
+{
+    computeClues();
+}
+
+Board::State BoardMap::get(int x, int y) const {
+    assertInbounds(x, y);
+    return m_map.get(x, y);
 }
 
 void BoardMap::genRandom() {
@@ -65,6 +77,49 @@ void BoardMap::genRandom() {
     }
 
     for (int i = 0; i < indices.size(); i++) {
-        m_state[indices[i]] = Box;
+        m_map.set(i_to_x(indices[i]), i_to_y(indices[i]), Box);
+    }
+}
+
+void BoardMap::computeClues() {
+    /* A single pass over the packed rows. Row streaks are closed at the
+     * first Nothing cell, column streaks are tracked in col_run until a row
+     * without a box in that column is reached. */
+
+    m_row_clues.resize(m_height);
+    m_col_clues.resize(m_width);
+
+    QVector<int> col_run(m_width, 0);
+    for (int y = 0; y < m_height; y++) {
+        const uchar *row = m_map.row(y);
+        QVector<int> &row_clues = m_row_clues[y];
+        int row_run = 0;
+
+        for (int x = 0; x < m_width; x++) {
+            if ((row[x / 8] >> (x % 8)) & 1) {
+                row_run++;
+                col_run[x]++;
+                continue;
+            }
+
+            if (row_run > 0) {
+                row_clues.append(row_run);
+                row_run = 0;
+            }
+            if (col_run[x] > 0) {
+                m_col_clues[x].append(col_run[x]);
+                col_run[x] = 0;
+            }
+        }
+
+        if (row_run > 0) {
+            row_clues.append(row_run);
+        }
+    }
+
+    for (int x = 0; x < m_width; x++) {
+        if (col_run[x] > 0) {
+            m_col_clues[x].append(col_run[x]);
+        }
     }
 }
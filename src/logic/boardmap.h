@@ -20,9 +20,13 @@
 #define BOARDMAP_H
 
 #include <QList>
+#include <QVector>
 
 #include "board.h"
+#include "packedmap.h"
 
+/* The immutable solution of a game. Cells are kept in a PackedMap, which
+   allows sharing them with the Level a board was started from. */
 class BoardMap : public Board
 {
 public:
@@ -31,14 +35,32 @@ public:
 
     BoardMap(int width, int height, const QList<Board::State> &map);
 
+    /* shares the bits of map, no cells are copied. map must not be null */
+    explicit BoardMap(const PackedMap &map);
+
+    enum State get(int x, int y) const;
+
     /* returns the total box count */
     int boxCount() const { return m_box_count; }
 
+    const PackedMap &packedMap() const { return m_map; }
+
+    /* return the clues of row y and column x, i.e. the lengths of their box
+       streaks in order. these are computed once on construction.
+       0 <= x < width(); 0 <= y < height() */
+    const QVector<int> &rowClues(int y) const { return m_row_clues[y]; }
+    const QVector<int> &colClues(int x) const { return m_col_clues[x]; }
+
 private:
     void genRandom();
+    void computeClues();
 
 private:
+    PackedMap m_map;
     const int m_box_count;
+
+    QVector<QVector<int> > m_row_clues;
+    QVector<QVector<int> > m_col_clues;
 };
 
 #endif // BOARDMAP_H
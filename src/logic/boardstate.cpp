@@ -21,10 +21,16 @@
 #include <algorithm>
 #include <assert.h>
 
-BoardState::BoardState(int width, int height) : Board(width, height), m_box_count(0)
+BoardState::BoardState(int width, int height) :
+    Board(width, height), m_state(width * height, Nothing), m_box_count(0)
 {
 }
 
+Board::State BoardState::get(int x, int y) const {
+    assertInbounds(x, y);
+    return m_state[xy_to_i(x, y)];
+}
+
 void BoardState::set(int x, int y, State state) {
     assertInbounds(x, y);
 
@@ -135,3 +141,83 @@ void BoardState::solve(const Board *board) {
 
     replace(Board::Nothing, Board::Cross);
 }
+
+void BoardState::save(QDataStream &out) const {
+    QByteArray cells(m_state.size(), 0);
+    char *data = cells.data();
+    for (int i = 0; i < m_state.size(); i++) {
+        data[i] = (char)m_state[i];
+    }
+
+    QByteArray undo_queue;
+    undo_queue.reserve(m_undo_queue.size() * 9);
+    QDataStream undo_stream(&undo_queue, QIODevice::WriteOnly);
+    for (int i = 0; i < m_undo_queue.size(); i++) {
+        const UndoAction &action = m_undo_queue[i];
+        undo_stream << (qint32)action.x << (qint32)action.y << (quint8)action.state;
+    }
+
+    out << cells << (qint32)m_undo_queue.size() << undo_queue
+        << QVector<int>(m_saved_states);
+}
+
+bool BoardState::restore(QDataStream &in) {
+    QByteArray cells, undo_queue;
+    qint32 undo_size;
+    QVector<int> saved_states;
+
+    in >> cells >> undo_size >> undo_queue >> saved_states;
+    if (in.status() != QDataStream::Ok || cells.size() != m_size || undo_size < 0) {
+        return false;
+    }
+
+    QStack<UndoAction> actions;
+    actions.reserve(undo_size);
+    QDataStream undo_stream(undo_queue);
+    for (int i = 0; i < undo_size; i++) {
+        qint32 x, y;
+        quint8 state;
+        undo_stream >> x >> y >> state;
+        if (undo_stream.status() != QDataStream::Ok || outOfBounds(x, y) || state > Cross) {
+            return false;
+        }
+
+        UndoAction action;
+        action.x = x;
+        action.y = y;
+        action.state = (State)state;
+        actions.push(action);
+    }
+
+    for (int i = 0; i < saved_states.size(); i++) {
+        if (saved_states[i] < 0 || saved_states[i] > undo_size) {
+            return false;
+        }
+    }
+
+    const char *data = cells.constData();
+    for (int i = 0; i < m_size; i++) {
+        if (data[i] < Nothing || data[i] > Cross) {
+            return false;
+        }
+    }
+
+    m_box_count = 0;
+    for (int i = 0; i < m_size; i++) {
+        m_state[i] = (State)data[i];
+        if (m_state[i] == Box) {
+            m_box_count++;
+        }
+    }
+
+    m_undo_queue = actions;
+    m_saved_states.clear();
+    for (int i = 0; i < saved_states.size(); i++) {
+        m_saved_states.push(saved_states[i]);
+    }
+
+    emit undoStackSizeChanged(m_undo_queue.size());
+    emit saveStackSizeChanged(m_saved_states.size());
+
+    return true;
+}
@@ -19,6 +19,7 @@
 #ifndef BOARDSTATE_H
 #define BOARDSTATE_H
 
+#include <QDataStream>
 #include <QPoint>
 #include <QStack>
 #include <QVector>
@@ -35,6 +36,8 @@ public:
       width, height > 0 */
     BoardState(int width, int height);
 
+    enum State get(int x, int y) const;
+
     /* 0 <= x < m_width; 0 <= y < m_height
       sets point (x, y) to state */
     void set(int x, int y, enum State state);
@@ -59,6 +62,17 @@ public:
     /* returns the count of player-set boxes */
     int boxCount() const { return m_box_count; }
 
+    int undoStackSize() const { return m_undo_queue.size(); }
+    int saveStackSize() const { return m_saved_states.size(); }
+
+    /* serializes the cell states together with the undo history
+       and saved states */
+    void save(QDataStream &out) const;
+
+    /* restores a state written by save(). returns false if the stream
+       does not contain a valid state for a board of this size */
+    bool restore(QDataStream &in);
+
     /* replaces all occurrences of prev with next.
        bookkeeping information (undo history, box count) is _not_ updated */
     void replace(enum State prev, enum State next);
@@ -83,6 +97,8 @@ private:
         enum State state;
     };
 
+    QVector<enum State> m_state;
+
     QStack<UndoAction> m_undo_queue;
     QStack<int> m_saved_states;     /* size of m_undo_queue when state was saved */
 
@@ -43,6 +43,23 @@ void ElapsedTime::addPenaltyTime() {
     }
 }
 
+void ElapsedTime::addTime(int secs) {
+    m_elapsed += secs;
+}
+
+void ElapsedTime::save(QDataStream &out) const {
+    out << m_start_date << (qint32)elapsedSecs() << (qint32)m_next_penalty;
+}
+
+void ElapsedTime::restore(QDataStream &in) {
+    qint32 elapsed, next_penalty;
+    in >> m_start_date >> elapsed >> next_penalty;
+
+    m_elapsed = elapsed;
+    m_next_penalty = next_penalty;
+    m_start = QDateTime::currentMSecsSinceEpoch();
+}
+
 void ElapsedTime::start() {
     if (m_stopped) {
         return;
@@ -19,6 +19,7 @@
 #ifndef ELAPSEDTIME_H
 #define ELAPSEDTIME_H
 
+#include <QDataStream>
 #include <QDateTime>
 
 class Time
@@ -47,6 +48,14 @@ public:
     /* adds penalty time and increases the next penalty amount */
     void addPenaltyTime();
 
+    /* adds secs to the elapsed time */
+    void addTime(int secs);
+
+    /* serializes the elapsed time, start date and penalty amount.
+       a restored timer continues from the saved elapsed time. */
+    void save(QDataStream &out) const;
+    void restore(QDataStream &in);
+
     /* return elapsed seconds the the datetime when start() was called */
     int elapsedSecs() const;
     QDateTime startDate() const;
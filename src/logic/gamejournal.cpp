@@ -0,0 +1,217 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "gamejournal.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "picmi.h"
+#include "sessionlog.h"
+
+static const quint32 SNAPSHOT_MAGIC = 0x504d534e; /* "PMSN" */
+static const quint32 SNAPSHOT_VERSION = 2;
+
+GameJournal::GameJournal(const QString &directory, QObject *parent) :
+    QObject(parent),
+    m_directory(directory.isEmpty()
+                ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journal"
+                : directory),
+    m_header_size(0), m_changes_since_snapshot(0)
+{
+}
+
+QString GameJournal::journalPath() const {
+    return m_directory + "/game.pmsl";
+}
+
+QString GameJournal::snapshotPath() const {
+    return m_directory + "/game.snapshot";
+}
+
+void GameJournal::start(QSharedPointer<Picmi> game, const QString &tag) {
+    discard();
+
+    if (!QDir().mkpath(m_directory)) {
+        return;
+    }
+
+    m_tag = tag;
+    if (!attach(game, false, 0, QPoint(0, 0))) {
+        return;
+    }
+
+    /* The initial snapshot stores the tag and marks the journal as valid. */
+    snapshot();
+}
+
+bool GameJournal::attach(QSharedPointer<Picmi> game, bool resume, qint64 last_msecs,
+                         const QPoint &last_pos) {
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Unbuffered;
+    mode |= resume ? QIODevice::Append : QIODevice::Truncate;
+
+    m_file = QSharedPointer<QFile>(new QFile(journalPath()));
+    if (!m_file->open(mode)) {
+        m_file.clear();
+        return false;
+    }
+
+    m_recorder = QSharedPointer<SessionRecorder>(new SessionRecorder(m_file.data()));
+    if (resume) {
+        m_recorder->resume(last_msecs, last_pos);
+    }
+
+    m_game = game;
+    game->setRecorder(m_recorder);
+    if (!resume) {
+        m_header_size = m_file->size();
+    }
+    connect(game.data(), &Picmi::stateChanged, this, &GameJournal::stateChanged);
+
+    return true;
+}
+
+void GameJournal::detach() {
+    QSharedPointer<Picmi> game = m_game.toStrongRef();
+    if (game) {
+        game->setRecorder(QSharedPointer<SessionRecorder>());
+        disconnect(game.data(), 0, this, 0);
+    }
+
+    m_game.clear();
+    m_recorder.clear();
+    m_file.clear();
+    m_header_size = 0;
+    m_changes_since_snapshot = 0;
+}
+
+void GameJournal::stateChanged() {
+    if (++m_changes_since_snapshot >= SNAPSHOT_INTERVAL) {
+        snapshot();
+    }
+}
+
+void GameJournal::snapshot() {
+    QSharedPointer<Picmi> game = m_game.toStrongRef();
+    if (!game || !m_file) {
+        return;
+    }
+
+    QSaveFile file(snapshotPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_2);
+    out << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << m_tag
+        << SessionRecorder::hash(*game->getBoardMap())
+        << (qint32)m_header_size << (qint64)m_file->size() << m_recorder->lastMsecs() << m_recorder->lastPos();
+    game->saveSnapshot(out);
+
+    if (file.commit()) {
+        m_changes_since_snapshot = 0;
+    }
+}
+
+void GameJournal::discard() {
+    detach();
+    QFile::remove(snapshotPath());
+    QFile::remove(journalPath());
+}
+
+QSharedPointer<Picmi> GameJournal::restore(QString *tag) {
+    detach();
+
+    QFile snapshot_file(snapshotPath());
+    QFile journal_file(journalPath());
+    if (!snapshot_file.open(QIODevice::ReadOnly) || !journal_file.open(QIODevice::ReadOnly)) {
+        return QSharedPointer<Picmi>();
+    }
+
+    QDataStream in(&snapshot_file);
+    in.setVersion(QDataStream::Qt_5_2);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        return QSharedPointer<Picmi>();
+    }
+
+    QString snapshot_tag;
+    quint64 hash;
+    qint32 header_size;
+    qint64 offset, msecs;
+    QPoint pos;
+    in >> snapshot_tag >> hash >> header_size >> offset >> msecs >> pos;
+    if (in.status() != QDataStream::Ok || header_size <= 0 || offset < header_size
+            || offset > journal_file.size()) {
+        return QSharedPointer<Picmi>();
+    }
+
+    /* Read the header and the tail written since the snapshot, skipping
+       the events the snapshot already contains. */
+
+    QByteArray data = journal_file.read(header_size);
+    if (data.size() != header_size || !journal_file.seek(offset)) {
+        return QSharedPointer<Picmi>();
+    }
+    data.append(journal_file.readAll());
+    journal_file.close();
+
+    SessionReader reader(data);
+    if (!reader.isValid() || reader.mapHash() != hash || reader.headerSize() != header_size
+            || !reader.seek(header_size, msecs, pos)) {
+        return QSharedPointer<Picmi>();
+    }
+
+    QSharedPointer<Picmi> game(new Picmi(reader.map(), reader.preventMistakes()));
+    if (!game->restoreSnapshot(in)) {
+        return QSharedPointer<Picmi>();
+    }
+
+    /* Replay the tail written since the snapshot. */
+
+    int changes = 0;
+    SessionEvent event;
+    while (reader.readEvent(&event)) {
+        SessionPlayer::apply(game.data(), event);
+        changes++;
+    }
+    game->addElapsedSecs((reader.lastMsecs() - msecs) / 1000);
+
+    /* Drop a partially written trailing event before appending to the journal. */
+
+    if (!QFile::resize(journalPath(), offset + reader.offset() - header_size)) {
+        return QSharedPointer<Picmi>();
+    }
+
+    m_tag = snapshot_tag;
+    m_header_size = header_size;
+    if (!attach(game, true, reader.lastMsecs(), reader.lastPos())) {
+        return QSharedPointer<Picmi>();
+    }
+    m_changes_since_snapshot = changes;
+
+    if (tag) {
+        *tag = m_tag;
+    }
+
+    return game;
+}
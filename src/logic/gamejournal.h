@@ -0,0 +1,91 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef GAMEJOURNAL_H
+#define GAMEJOURNAL_H
+
+#include <QFile>
+#include <QObject>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+class Picmi;
+class SessionRecorder;
+
+/* Keeps the game in progress on disk so that it survives restarts and crashes.
+
+   Every action is appended to a journal file (a session log, see sessionlog.h).
+   SessionRecorder encodes each event into a small buffer of a few bytes which
+   is handed to the file with a single write. QFile's own buffer is disabled:
+   it would hold back many moves until flushed and lose them on a crash, while
+   a write per move costs little next to the redraw it causes. The journal is
+   not synced to disk, so a crash of the system may still lose recent moves.
+
+   Every SNAPSHOT_INTERVAL state changes, a snapshot of the complete game
+   state is written atomically together with the journal offset it
+   corresponds to. Restoring a game loads the latest snapshot and reads only
+   the journal header, which holds the map, and the tail written after the
+   snapshot. */
+class GameJournal : public QObject
+{
+    Q_OBJECT
+public:
+    /* journal files are stored in directory, which defaults to
+       the application data location */
+    explicit GameJournal(const QString &directory = QString(), QObject *parent = 0);
+
+    /* starts journaling game, replacing any previous journal. tag is stored
+       along with the game and returned by restore() */
+    void start(QSharedPointer<Picmi> game, const QString &tag);
+
+    /* restores the last journaled game and continues journaling it.
+       returns a null pointer if no valid journal exists */
+    QSharedPointer<Picmi> restore(QString *tag = 0);
+
+    /* writes a snapshot of the journaled game */
+    void snapshot();
+
+    /* stops journaling and removes the journal */
+    void discard();
+
+    /* returns the game that is currently journaled */
+    QSharedPointer<Picmi> game() const { return m_game.toStrongRef(); }
+
+private slots:
+    void stateChanged();
+
+private:
+    QString journalPath() const;
+    QString snapshotPath() const;
+
+    /* opens the journal for appending and attaches a recorder to game */
+    bool attach(QSharedPointer<Picmi> game, bool resume, qint64 last_msecs,
+                const QPoint &last_pos);
+    void detach();
+
+    static const int SNAPSHOT_INTERVAL = 256;
+
+    const QString m_directory;
+    QWeakPointer<Picmi> m_game;
+    QSharedPointer<QFile> m_file;
+    QSharedPointer<SessionRecorder> m_recorder;
+    QString m_tag;
+    int m_header_size;
+    int m_changes_since_snapshot;
+};
+
+#endif // GAMEJOURNAL_H
@@ -0,0 +1,179 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "imageimporter.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QVector>
+
+#include "levelloader.h"
+#include "src/systemexception.h"
+
+/* returns the grey level of c drawn onto a white background */
+static inline int luma(QRgb c) {
+    return 255 - (255 - qGray(c)) * qAlpha(c) / 255;
+}
+
+/* returns image as opaque greys, with transparency blended onto white */
+static QImage flatten(const QImage &image) {
+    if (!image.hasAlphaChannel()) {
+        return image.convertToFormat(QImage::Format_RGB32);
+    }
+
+    const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+    QImage flat(argb.size(), QImage::Format_RGB32);
+    for (int y = 0; y < argb.height(); y++) {
+        const QRgb *src = reinterpret_cast<const QRgb *>(argb.constScanLine(y));
+        QRgb *dst = reinterpret_cast<QRgb *>(flat.scanLine(y));
+        for (int x = 0; x < argb.width(); x++) {
+            const int l = luma(src[x]);
+            dst[x] = qRgb(l, l, l);
+        }
+    }
+    return flat;
+}
+
+ImageImporter::ImageImporter() : m_mode(Threshold), m_threshold(128) { }
+
+bool ImageImporter::isImage(const QString &path) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    return (suffix == "xpm" || suffix == "png" || suffix == "pbm");
+}
+
+QStringList ImageImporter::nameFilters() {
+    return QStringList() << "*.xpm" << "*.png" << "*.pbm";
+}
+
+PackedMap ImageImporter::load(const QString &path) const {
+    QImageReader reader(path);
+    const QImage image = reader.read();
+
+    if (image.isNull()) {
+        throw SystemException(QString("Could not load %1: %2")
+                              .arg(path, reader.errorString()));
+    }
+
+    return convert(image);
+}
+
+PackedMap ImageImporter::convert(const QImage &image) const {
+    if (image.isNull()) {
+        throw SystemException("Null image");
+    }
+
+    /* Format_MonoLSB shares the bit order of PackedMap, so rows are
+       translated a byte at a time. The color table decides whether set or
+       cleared bits are boxes. */
+
+    const QImage mono = toMono(image);
+    const QVector<QRgb> colors = mono.colorTable();
+    const uchar set_mask = (luma(colors.value(1)) < m_threshold) ? 0xff : 0x00;
+    const uchar clear_mask = (luma(colors.value(0)) < m_threshold) ? 0xff : 0x00;
+
+    const int width = mono.width();
+    const int height = mono.height();
+    const int stride = PackedMap::stride(width);
+    const uchar padding = (width % 8 == 0) ? 0xff : (uchar)((1 << (width % 8)) - 1);
+
+    QByteArray bits(height * stride, 0);
+    uchar *dst = reinterpret_cast<uchar *>(bits.data());
+    for (int y = 0; y < height; y++, dst += stride) {
+        const uchar *src = mono.constScanLine(y);
+        for (int i = 0; i < stride; i++) {
+            dst[i] = (src[i] & set_mask) | (~src[i] & clear_mask);
+        }
+        dst[stride - 1] &= padding;
+    }
+
+    return PackedMap(width, height, bits);
+}
+
+QImage ImageImporter::toMono(const QImage &image) const {
+    if (image.depth() == 1) {
+        /* At most reorders the bits, the color table is kept. */
+        return image.convertToFormat(QImage::Format_MonoLSB);
+    }
+
+    if (m_mode == Dither) {
+        return flatten(image).convertToFormat(QImage::Format_MonoLSB,
+                                              Qt::MonoOnly | Qt::DiffuseDither);
+    }
+
+    return threshold(image);
+}
+
+QImage ImageImporter::threshold(const QImage &image) const {
+    /* Qt only thresholds at 50%, so this is done by hand. Set bits are
+       black. */
+
+    QImage mono(image.size(), QImage::Format_MonoLSB);
+    mono.setColorTable(QVector<QRgb>() << qRgb(255, 255, 255) << qRgb(0, 0, 0));
+    mono.fill(0);
+
+    if (image.format() == QImage::Format_Indexed8) {
+        /* Palette images (e.g. XPM) are classified once per color. */
+
+        const QVector<QRgb> colors = image.colorTable();
+        bool box[256];
+        for (int i = 0; i < 256; i++) {
+            box[i] = (i < colors.size() && luma(colors[i]) < m_threshold);
+        }
+
+        for (int y = 0; y < image.height(); y++) {
+            const uchar *src = image.constScanLine(y);
+            uchar *dst = mono.scanLine(y);
+            for (int x = 0; x < image.width(); x++) {
+                if (box[src[x]]) {
+                    dst[x / 8] |= (1 << (x % 8));
+                }
+            }
+        }
+
+        return mono;
+    }
+
+    const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < argb.height(); y++) {
+        const QRgb *src = reinterpret_cast<const QRgb *>(argb.constScanLine(y));
+        uchar *dst = mono.scanLine(y);
+        for (int x = 0; x < argb.width(); x++) {
+            if (luma(src[x]) < m_threshold) {
+                dst[x / 8] |= (1 << (x % 8));
+            }
+        }
+    }
+
+    return mono;
+}
+
+QSharedPointer<Level> ImageImporter::loadLevel(const QString &path, const QString &levelset,
+                                               const QString &author) const {
+    try {
+        QSharedPointer<Level> level(new Level);
+        level->m_name = QFileInfo(path).completeBaseName();
+        level->m_author = author;
+        level->m_levelset = levelset;
+        level->m_difficulty = 0;
+        level->setMap(load(path));
+        return level;
+    } catch (const SystemException &e) {
+        qDebug() << "Importing image failed: " << e.what();
+        return QSharedPointer<Level>();
+    }
+}
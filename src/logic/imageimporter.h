@@ -0,0 +1,76 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef IMAGEIMPORTER_H
+#define IMAGEIMPORTER_H
+
+#include <QImage>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "src/logic/packedmap.h"
+
+class Level;
+
+/* Converts images into packed maps. Each image is converted to a one bit
+   per pixel format once, after which whole scanlines are copied into the
+   map instead of being read pixel by pixel. Transparent pixels count as
+   white, dark pixels become boxes. */
+class ImageImporter
+{
+public:
+    enum Mode {
+        Threshold,  /* pixels darker than threshold() are boxes */
+        Dither      /* greyscale is approximated by error diffusion */
+    };
+
+    ImageImporter();
+
+    Mode mode() const { return m_mode; }
+    void setMode(Mode mode) { m_mode = mode; }
+
+    /* 0 < threshold < 256, defaults to 128 */
+    int threshold() const { return m_threshold; }
+    void setThreshold(int threshold) { m_threshold = threshold; }
+
+    /* loads an XPM, PNG or PBM image. throws SystemException if path is not
+       a readable image */
+    PackedMap load(const QString &path) const;
+
+    /* converts image. throws SystemException if it is null */
+    PackedMap convert(const QImage &image) const;
+
+    /* loads path as a level named after the file. never throws, a null
+       pointer is returned if the image can't be read */
+    QSharedPointer<Level> loadLevel(const QString &path, const QString &levelset,
+                                    const QString &author) const;
+
+    static bool isImage(const QString &path);
+
+    /* returns the file patterns of supported images */
+    static QStringList nameFilters();
+
+private:
+    QImage toMono(const QImage &image) const;
+    QImage threshold(const QImage &image) const;
+
+    Mode m_mode;
+    int m_threshold;
+};
+
+#endif // IMAGEIMPORTER_H
@@ -0,0 +1,63 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "kdeadapter.h"
+
+#include "picmi.h"
+#include "src/settings.h"
+
+QSize KdeAdapter::boardSize(KgDifficultyLevel::StandardLevel level) {
+    switch (level) {
+    case KgDifficultyLevel::Easy: return QSize(10, 10);
+    case KgDifficultyLevel::Medium: return QSize(15, 10);
+    case KgDifficultyLevel::Hard: return QSize(15, 15);
+    default: return QSize(Settings::instance()->width(), Settings::instance()->height());
+    }
+}
+
+QSharedPointer<Picmi> KdeAdapter::createRandomGame() {
+    const KgDifficultyLevel::StandardLevel level = Settings::instance()->level();
+    const QSize size = boardSize(level);
+    const int width = size.width();
+    const int height = size.height();
+    double density;
+    bool prevent_mistakes;
+
+    switch (level) {
+    case KgDifficultyLevel::Easy:
+    case KgDifficultyLevel::Medium:
+    case KgDifficultyLevel::Hard: density = 0.55; prevent_mistakes = false; break;
+    case KgDifficultyLevel::Custom:
+    default:
+        density = Settings::instance()->boxDensity();
+        prevent_mistakes = Settings::instance()->preventMistakes();
+        break;
+    }
+
+    return QSharedPointer<Picmi>(new Picmi(width, height, density, prevent_mistakes));
+}
+
+KScoreDialog::FieldInfo KdeAdapter::endGame(Picmi *game) {
+    game->endGame();
+
+    KScoreDialog::FieldInfo score;
+    score[KScoreDialog::Score].setNum(game->elapsedSecs());
+    score[KScoreDialog::Time] = Time(game->elapsedSecs()).toString();
+    score[KScoreDialog::Date] = game->startDate().toString("dd MMM yyyy hh:mm");
+
+    return score;
+}
@@ -0,0 +1,44 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef KDEADAPTER_H
+#define KDEADAPTER_H
+
+#include <QSharedPointer>
+#include <QSize>
+#include <kgdifficulty.h>
+#include <highscore/kscoredialog.h>
+
+class Picmi;
+
+/* Glue between the Qt-only game core (picmi_core) and the KDE frameworks.
+   Anything requiring KDEGames or the application settings belongs here
+   rather than into the core classes. */
+class KdeAdapter
+{
+public:
+    /* creates a random game according to the current difficulty settings */
+    static QSharedPointer<Picmi> createRandomGame();
+
+    /* returns the board dimensions of a standard difficulty level */
+    static QSize boardSize(KgDifficultyLevel::StandardLevel level);
+
+    /* ends the given game and returns its high score object */
+    static KScoreDialog::FieldInfo endGame(Picmi *game);
+};
+
+#endif // KDEADAPTER_H
@@ -0,0 +1,241 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#include "levelcache.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "levelloader.h"
+
+static const quint32 CACHE_MAGIC = 0x504d4c43; /* "PMLC" */
+static const quint32 CACHE_VERSION = 2;
+
+LevelsetFile::LevelsetFile(const QString &path) :
+    path(path)
+{
+    QFileInfo info(path);
+    modified = info.lastModified().toMSecsSinceEpoch();
+    size = info.size();
+}
+
+LevelCache::LevelCache(const QString &path) :
+    m_file(new QFile(path.isEmpty() ? defaultPath() : path)), m_data(0), m_size(0)
+{
+    if (!m_file->open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    m_size = m_file->size();
+    m_data = m_file->map(0, m_size);
+
+    if (!m_data || !readIndex()) {
+        m_entries.clear();
+    }
+}
+
+QString LevelCache::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/levels.cache";
+}
+
+bool LevelCache::readIndex() {
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data), m_size);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_5_2);
+
+    quint32 magic, version, count;
+    in >> magic >> version >> count;
+    if (in.status() != QDataStream::Ok || magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        return false;
+    }
+
+    for (quint32 i = 0; i < count; i++) {
+        QString path;
+        Entry entry;
+        in >> path >> entry.modified >> entry.size >> entry.offset >> entry.length;
+
+        if (in.status() != QDataStream::Ok || entry.offset < 0 || entry.length < 0
+                || entry.offset + entry.length > m_size) {
+            return false;
+        }
+
+        m_entries.insert(path, entry);
+    }
+
+    return true;
+}
+
+/* returns true if the unused bits at the end of each row are zero, as
+   PackedMap::fromRawData() requires */
+static bool paddingClear(const char *bits, int width, int height) {
+    const int stride = PackedMap::stride(width);
+    const int padding = stride * 8 - width;
+    if (padding == 0) {
+        return true;
+    }
+
+    const uchar mask = 0xff >> padding;
+    for (int y = 0; y < height; y++) {
+        if (static_cast<uchar>(bits[y * stride + stride - 1]) & ~mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LevelCache::lookup(const LevelsetFile &file, QList<QSharedPointer<Level> > *levels) const {
+    QHash<QString, Entry>::const_iterator it = m_entries.constFind(file.path);
+    if (it == m_entries.constEnd() || it->modified != file.modified || it->size != file.size) {
+        return false;
+    }
+
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + it->offset),
+                                               it->length);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_5_2);
+
+    quint32 count;
+    in >> count;
+
+    /* Maps are stored as serialized QByteArrays, a quint32 length followed
+       by the bytes. Instead of copying them, the maps refer to the mapping. */
+
+    QList<QSharedPointer<Level> > l;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        QSharedPointer<Level> p(new Level);
+        qint32 difficulty, width, height;
+        quint32 length;
+        LevelMetadata metadata;
+        in >> p->m_name >> p->m_author >> p->m_levelset >> difficulty >> width >> height >> length;
+
+        const qint64 pos = in.device()->pos();
+        if (in.status() != QDataStream::Ok || width <= 0 || height <= 0
+                || length != (quint64)height * PackedMap::stride(width)
+                || pos + length > it->length) {
+            return false;
+        }
+
+        const char *bits = reinterpret_cast<const char *>(m_data + it->offset + pos);
+        if (!paddingClear(bits, width, height) || in.skipRawData(length) != (int)length) {
+            return false;
+        }
+
+        in >> metadata;
+        if (in.status() != QDataStream::Ok) {
+            return false;
+        }
+
+        p->m_difficulty = difficulty;
+        p->setMap(PackedMap::fromRawData(width, height, bits, m_file), metadata);
+
+        l.append(p);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    *levels = l;
+    return true;
+}
+
+bool LevelCache::isStale(const QList<LevelsetFile> &files) const {
+    if (files.size() != m_entries.size()) {
+        return true;
+    }
+
+    for (int i = 0; i < files.size(); i++) {
+        QHash<QString, Entry>::const_iterator it = m_entries.constFind(files[i].path);
+        if (it == m_entries.constEnd() || it->modified != files[i].modified
+                || it->size != files[i].size) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool LevelCache::write(const QString &path, const QList<LevelsetFile> &files,
+                       const QList<QList<QSharedPointer<Level> > > &levels) {
+    if (files.size() != levels.size()) {
+        return false;
+    }
+
+    /* Serialize the levelsets first, the index needs their offsets. Levels
+       which have just been parsed analyze their maps here, later loads read
+       the metadata from the cache. */
+
+    QList<QByteArray> blobs;
+    for (int i = 0; i < levels.size(); i++) {
+        QByteArray blob;
+        QDataStream out(&blob, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_2);
+
+        out << (quint32)levels[i].size();
+        for (int j = 0; j < levels[i].size(); j++) {
+            const Level *l = levels[i][j].data();
+            out << l->m_name << l->m_author << l->m_levelset << (qint32)l->m_difficulty
+                << (qint32)l->m_map.width() << (qint32)l->m_map.height() << l->m_map.bits()
+                << l->metadata();
+        }
+
+        blobs.append(blob);
+    }
+
+    QByteArray index;
+    QDataStream out(&index, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_2);
+
+    /* Offsets are fixed up in a second pass once the index size is known. */
+
+    qint64 header_size = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        out.device()->seek(0);
+        out << CACHE_MAGIC << CACHE_VERSION << (quint32)files.size();
+
+        qint64 offset = header_size;
+        for (int i = 0; i < files.size(); i++) {
+            out << files[i].path << files[i].modified << files[i].size
+                << offset << (qint64)blobs[i].size();
+            offset += blobs[i].size();
+        }
+
+        header_size = out.device()->pos();
+    }
+
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    file.write(index.constData(), header_size);
+    for (int i = 0; i < blobs.size(); i++) {
+        file.write(blobs[i]);
+    }
+
+    return file.commit();
+}
@@ -0,0 +1,89 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#ifndef LEVELCACHE_H
+#define LEVELCACHE_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+class Level;
+
+/* Identifies a version of a levelset file by its modification time and size. */
+struct LevelsetFile
+{
+    LevelsetFile() : modified(0), size(0) { }
+    explicit LevelsetFile(const QString &path);
+
+    bool operator==(const LevelsetFile &that) const {
+        return (path == that.path && modified == that.modified && size == that.size);
+    }
+
+    QString path;
+    qint64 modified; /* msecs since epoch */
+    qint64 size;
+};
+
+/* A binary cache of parsed levelsets, stored in the application data
+   location. The cache file is memory-mapped and holds an index of levelset
+   files, each followed by the packed levels it contained when it was
+   parsed. Levelsets which have been modified since are not returned.
+   Maps of the levels returned refer to the mapping, which stays alive as
+   long as they do. Rewriting the cache replaces the file, which relies on
+   open files being replaceable, as they are on POSIX systems.
+
+   A LevelCache instance is read-only and may be used from multiple threads. */
+class LevelCache
+{
+public:
+    /* opens the cache at path, which defaults to defaultPath() */
+    explicit LevelCache(const QString &path = QString());
+
+    static QString defaultPath();
+
+    /* if file is cached and has not been modified since, stores its levels
+       in levels and returns true */
+    bool lookup(const LevelsetFile &file, QList<QSharedPointer<Level> > *levels) const;
+
+    /* returns true unless the cache contains exactly the given files,
+       all of them up to date */
+    bool isStale(const QList<LevelsetFile> &files) const;
+
+    /* replaces the cache at path by one containing files, where levels[i]
+       are the levels of files[i]. the cache must not be open while writing */
+    static bool write(const QString &path, const QList<LevelsetFile> &files,
+                      const QList<QList<QSharedPointer<Level> > > &levels);
+
+private:
+    struct Entry {
+        qint64 modified, size;
+        qint64 offset, length;
+    };
+
+    bool readIndex();
+
+    QSharedPointer<QFile> m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    QHash<QString, Entry> m_entries;
+};
+
+#endif // LEVELCACHE_H
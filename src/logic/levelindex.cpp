@@ -0,0 +1,356 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "levelindex.h"
+
+#include <QSet>
+#include <algorithm>
+#include <limits.h>
+
+#include "levelloader.h"
+
+LevelIndex::LevelIndex() : m_ranges_dirty(false) { }
+
+QVector<int> LevelIndex::insert(const QList<QSharedPointer<Level> > &levels) {
+    QVector<int> ids;
+    for (int i = 0; i < levels.size(); i++) {
+        int id;
+        if (!m_free.isEmpty()) {
+            id = m_free.takeLast();
+        } else {
+            id = m_levels.size();
+            m_levels.append(QSharedPointer<Level>());
+        }
+        m_levels[id] = levels[i];
+        ids.append(id);
+    }
+
+    const int n = m_levels.size();
+    m_live.resize(n);
+    m_solved.resize(n);
+    m_unique.resize(n);
+    for (int i = 0; i < FieldCount; i++) {
+        m_tokens[i].resize(n);
+    }
+    for (int i = 0; i < AttributeCount; i++) {
+        m_values[i].resize(n);
+    }
+
+    for (int i = 0; i < ids.size(); i++) {
+        m_live.setBit(ids[i]);
+        index(ids[i]);
+    }
+    m_ranges_dirty = true;
+
+    return ids;
+}
+
+void LevelIndex::remove(const QVector<int> &ids) {
+    for (int i = 0; i < FieldCount; i++) {
+        unindexTokens(i, ids);
+    }
+
+    for (int i = 0; i < ids.size(); i++) {
+        const int id = ids[i];
+        m_levels[id].clear();
+        m_live.clearBit(id);
+        m_solved.clearBit(id);
+        m_unique.clearBit(id);
+        m_free.append(id);
+    }
+    m_ranges_dirty = true;
+}
+
+void LevelIndex::update(const QVector<int> &ids) {
+    /* Only names depend on the solved state and the language. */
+
+    QVector<int> renamed;
+    QList<QStringList> names;
+    for (int i = 0; i < ids.size(); i++) {
+        const int id = ids[i];
+        updateValues(id);
+
+        const QStringList tokens = tokenize(nameOf(*m_levels[id]));
+        if (tokens != m_tokens[Name][id]) {
+            renamed.append(id);
+            names.append(tokens);
+        }
+    }
+
+    unindexTokens(Name, renamed);
+    for (int i = 0; i < renamed.size(); i++) {
+        indexTokens(Name, renamed[i], names[i]);
+    }
+    m_ranges_dirty = true;
+}
+
+QBitArray LevelIndex::match(const QString &query) const {
+    QBitArray result = m_live;
+
+    const QStringList terms = query.simplified().split(' ', QString::SkipEmptyParts);
+    for (int i = 0; i < terms.size(); i++) {
+        result &= matchTerm(terms[i]);
+    }
+
+    return result;
+}
+
+QBitArray LevelIndex::matchTerm(const QString &term) const {
+    const QString lower = term.toLower();
+    if (lower == "solved") {
+        return m_solved;
+    } else if (lower == "unsolved") {
+        return m_live & ~m_solved;
+    } else if (lower == "unique") {
+        return m_unique;
+    }
+
+    static const struct {
+        const char *prefix;
+        Field field;
+    } fields[] = {
+        { "name:", Name },
+        { "author:", Author },
+        { "set:", Levelset },
+        { "levelset:", Levelset }
+    };
+
+    for (unsigned int i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        const QLatin1String prefix(fields[i].prefix);
+        if (lower.startsWith(prefix)) {
+            return matchWords(term.mid(prefix.size()), fields[i].field);
+        }
+    }
+
+    QBitArray result;
+    if (matchRange(lower, &result)) {
+        return result;
+    }
+
+    return matchWords(term, FieldCount);
+}
+
+QBitArray LevelIndex::matchWords(const QString &text, int field) const {
+    QBitArray result = m_live;
+
+    const QStringList tokens = tokenize(text);
+    for (int i = 0; i < tokens.size(); i++) {
+        QBitArray matches(size());
+        if (field == FieldCount) {
+            for (int j = 0; j < FieldCount; j++) {
+                matchPrefix(j, tokens[i], &matches);
+            }
+        } else {
+            matchPrefix(field, tokens[i], &matches);
+        }
+        result &= matches;
+    }
+
+    return result;
+}
+
+void LevelIndex::matchPrefix(int field, const QString &prefix, QBitArray *result) const {
+    const Postings &postings = m_postings[field];
+    for (Postings::const_iterator it = postings.lowerBound(prefix);
+         it != postings.constEnd() && it.key().startsWith(prefix); ++it) {
+        const QVector<int> &ids = it.value();
+        for (int i = 0; i < ids.size(); i++) {
+            result->setBit(ids[i]);
+        }
+    }
+}
+
+bool LevelIndex::matchRange(const QString &term, QBitArray *result) const {
+    static const char *const keys[AttributeCount] = {
+        "difficulty", "width", "height", "size", "time", "density", "clues",
+        "guesses"
+    };
+
+    int pos = 0;
+    while (pos < term.size() && term[pos].isLetter()) {
+        pos++;
+    }
+
+    int attribute = -1;
+    for (int i = 0; i < AttributeCount; i++) {
+        if (term.leftRef(pos) == QLatin1String(keys[i])) {
+            attribute = i;
+        }
+    }
+    if (attribute < 0) {
+        return false;
+    }
+
+    int end = pos;
+    while (end < term.size() && QString("<>=:").contains(term[end])) {
+        end++;
+    }
+
+    bool ok;
+    const qint64 value = term.mid(end).toInt(&ok);
+    if (!ok) {
+        return false;
+    }
+
+    const QString op = term.mid(pos, end - pos);
+    qint64 lo = 0, hi = INT_MAX;
+    if (op == "=" || op == ":") {
+        lo = hi = value;
+    } else if (op == "<") {
+        hi = value - 1;
+    } else if (op == "<=") {
+        hi = value;
+    } else if (op == ">") {
+        lo = value + 1;
+    } else if (op == ">=") {
+        lo = value;
+    } else {
+        return false;
+    }
+
+    *result = QBitArray(size());
+    lo = qMax(lo, Q_INT64_C(0));
+    if (lo > hi) {
+        return true;
+    }
+
+    /* Keys within [lo, hi] are consecutive. */
+
+    sortRanges();
+    const QVector<quint64> &range = m_ranges[attribute];
+    const quint64 first = quint64(lo) << 32;
+    const quint64 last = (quint64(hi) << 32) | 0xffffffff;
+    for (QVector<quint64>::const_iterator it = std::lower_bound(range.constBegin(), range.constEnd(), first);
+         it != range.constEnd() && *it <= last; ++it) {
+        result->setBit(int(*it & 0xffffffff));
+    }
+
+    return true;
+}
+
+void LevelIndex::index(int id) {
+    const Level &level = *m_levels[id];
+    indexTokens(Name, id, tokenize(nameOf(level)));
+    indexTokens(Author, id, tokenize(level.author()));
+    indexTokens(Levelset, id, tokenize(level.levelset()));
+    updateValues(id);
+}
+
+void LevelIndex::indexTokens(int field, int id, const QStringList &tokens) {
+    m_tokens[field][id] = tokens;
+    for (int i = 0; i < tokens.size(); i++) {
+        m_postings[field][tokens[i]].append(id);
+    }
+}
+
+void LevelIndex::unindexTokens(int field, const QVector<int> &ids) {
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    /* Each affected posting list is filtered once, which keeps removing
+       many levels sharing a token (e.g. a whole levelset) linear. */
+
+    QBitArray removed(size());
+    QSet<QString> tokens;
+    for (int i = 0; i < ids.size(); i++) {
+        removed.setBit(ids[i]);
+        const QStringList &t = m_tokens[field][ids[i]];
+        for (int j = 0; j < t.size(); j++) {
+            tokens.insert(t[j]);
+        }
+        m_tokens[field][ids[i]].clear();
+    }
+
+    Postings &postings = m_postings[field];
+    for (QSet<QString>::const_iterator token = tokens.constBegin(); token != tokens.constEnd(); ++token) {
+        Postings::iterator it = postings.find(*token);
+        if (it == postings.end()) {
+            continue;
+        }
+
+        QVector<int> &list = it.value();
+        int n = 0;
+        for (int i = 0; i < list.size(); i++) {
+            if (!removed.testBit(list[i])) {
+                list[n++] = list[i];
+            }
+        }
+
+        if (n == 0) {
+            postings.erase(it);
+        } else {
+            list.resize(n);
+        }
+    }
+}
+
+void LevelIndex::updateValues(int id) {
+    const Level &level = *m_levels[id];
+    m_values[Difficulty][id] = qMax(0, level.difficulty());
+    m_values[Width][id] = level.width();
+    m_values[Height][id] = level.height();
+    m_values[Size][id] = qMax(level.width(), level.height());
+    m_values[Time][id] = level.solved() ? qMax(0, level.solvedTime()) : -1;
+    m_solved.setBit(id, level.solved());
+
+    const LevelMetadata &metadata = level.metadata();
+    m_values[Density][id] = qRound(100 * metadata.density());
+    m_values[Clues][id] = metadata.clues;
+    m_values[Guesses][id] = metadata.guesses;
+    m_unique.setBit(id, metadata.unique);
+}
+
+void LevelIndex::sortRanges() const {
+    if (!m_ranges_dirty) {
+        return;
+    }
+
+    for (int i = 0; i < AttributeCount; i++) {
+        QVector<quint64> &range = m_ranges[i];
+        range.clear();
+        for (int id = 0; id < size(); id++) {
+            if (!m_live.testBit(id) || m_values[i][id] < 0) {
+                continue;
+            }
+            range.append((quint64(m_values[i][id]) << 32) | quint32(id));
+        }
+        std::sort(range.begin(), range.end());
+    }
+
+    m_ranges_dirty = false;
+}
+
+QStringList LevelIndex::tokenize(const QString &text) {
+    QStringList tokens;
+    QString token;
+    for (int i = 0; i <= text.size(); i++) {
+        if (i < text.size() && text[i].isLetterOrNumber()) {
+            token += text[i].toLower();
+        } else if (!token.isEmpty()) {
+            if (!tokens.contains(token)) {
+                tokens.append(token);
+            }
+            token.clear();
+        }
+    }
+    return tokens;
+}
+
+QString LevelIndex::nameOf(const Level &level) {
+    return level.solved() ? level.name() : QString();
+}
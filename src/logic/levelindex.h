@@ -0,0 +1,124 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef LEVELINDEX_H
+#define LEVELINDEX_H
+
+#include <QBitArray>
+#include <QList>
+#include <QMap>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class Level;
+
+/* An in-memory index answering filter queries over a set of levels.
+   Words are looked up through inverted indexes of the name, author and
+   levelset tokens, comparisons through sorted range indexes. Levels are
+   identified by small integer ids, results are bit arrays indexed by them.
+
+   Names are translated and masked like in the level table: the name of an
+   unsolved level is not searchable. Accessible from the GUI thread only. */
+class LevelIndex
+{
+public:
+    LevelIndex();
+
+    /* adds levels and returns their ids. ids of removed levels are reused */
+    QVector<int> insert(const QList<QSharedPointer<Level> > &levels);
+
+    /* removes the levels with the given ids */
+    void remove(const QVector<int> &ids);
+
+    /* reindexes the levels with the given ids after their solved state or
+       the application language has changed */
+    void update(const QVector<int> &ids);
+
+    /* returns the upper bound of all ids, which is the size of match() */
+    int size() const { return m_levels.size(); }
+
+    /* returns the levels matching query. a query is a whitespace separated
+       list of terms, all of which must match:
+
+         word               a name, author or levelset token starts with word
+         name:word          the same for a single field, author: and set:
+                            restrict the search likewise
+         solved, unsolved   the level's solved state
+         unique             the level's clues have a single solution
+         key<op>number      key is one of difficulty, width, height, size
+                            (the larger dimension), time (the solve time
+                            in seconds), density (the percentage of boxes),
+                            clues and guesses (needed by the solver), op
+                            one of =, :, <, <=, > and >=
+
+       words are case insensitive. an empty query matches all levels */
+    QBitArray match(const QString &query) const;
+
+private:
+    enum Field {
+        Name,
+        Author,
+        Levelset,
+        FieldCount
+    };
+
+    enum Attribute {
+        Difficulty,
+        Width,
+        Height,
+        Size,
+        Time,
+        Density,
+        Clues,
+        Guesses,
+        AttributeCount
+    };
+
+    typedef QMap<QString, QVector<int> > Postings;
+
+    QBitArray matchTerm(const QString &term) const;
+    QBitArray matchWords(const QString &text, int field) const;
+    bool matchRange(const QString &term, QBitArray *result) const;
+    void matchPrefix(int field, const QString &prefix, QBitArray *result) const;
+
+    void index(int id);
+    void indexTokens(int field, int id, const QStringList &tokens);
+    void unindexTokens(int field, const QVector<int> &ids);
+    void updateValues(int id);
+    void sortRanges() const;
+
+    static QStringList tokenize(const QString &text);
+    static QString nameOf(const Level &level);
+
+    QVector<QSharedPointer<Level> > m_levels;   /* id -> level */
+    QVector<int> m_free;
+    QBitArray m_live, m_solved, m_unique;
+
+    Postings m_postings[FieldCount];            /* token -> ids */
+    QVector<QStringList> m_tokens[FieldCount];  /* id -> tokens */
+
+    /* The values of each attribute by id, -1 if a level has none, and the
+       keys (value << 32 | id) of all levels having one, sorted on first
+       use. */
+    QVector<int> m_values[AttributeCount];
+    mutable QVector<quint64> m_ranges[AttributeCount];
+    mutable bool m_ranges_dirty;
+};
+
+#endif // LEVELINDEX_H
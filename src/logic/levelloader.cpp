@@ -19,44 +19,112 @@
 #include "config.h"
 #include "levelloader.h"
 
+#include <KCompressionDevice>
 #include <KLocalizedString>
+#include <QCache>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
-#include <QDomDocument>
-#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSet>
 #include <QStandardPaths>
-
-#include "src/settings.h"
+#include <QtConcurrentMap>
+#include <string.h>
+
+#include "imageimporter.h"
+#include "levelcache.h"
+#include "levelpack.h"
+#include "presetscores.h"
+#include "puzzleimporter.h"
 #include "src/systemexception.h"
 
+/* A list of levels without duplicates, see LevelLoader::deduplicate().
+   Levels are indexed by name and author as well as by map hash, which
+   makes appending linear in the number of levels. */
 class LevelList : public QList<QSharedPointer<Level> >
 {
 public:
-    LevelList() : QList<QSharedPointer<Level> >() { }
-    void append(const QList<QSharedPointer<Level> > &t);
+    explicit LevelList(bool symmetric = false) :
+        QList<QSharedPointer<Level> >(), m_symmetric(symmetric) { }
+
+    /* appends all levels of t not contained yet and returns them */
+    QList<QSharedPointer<Level> > append(const QList<QSharedPointer<Level> > &t);
 private:
+    quint64 mapKey(const Level &level) const;
     bool containsLevel(QSharedPointer<Level> level) const;
+
+    const bool m_symmetric;
+    QSet<QPair<QString, QString> > m_names;
+    QHash<quint64, QSharedPointer<Level> > m_maps;
 };
 
-void LevelList::append(const QList<QSharedPointer<Level> > &t) {
+QList<QSharedPointer<Level> > LevelList::append(const QList<QSharedPointer<Level> > &t) {
+    QList<QSharedPointer<Level> > appended;
     for (int i = 0; i < t.size(); i++) {
         QSharedPointer<Level> level = t[i];
         if (!containsLevel(level)) {
             QList<QSharedPointer<Level> >::append(level);
+            m_names.insert(qMakePair(level->m_name, level->m_author));
+            m_maps.insert(mapKey(*level), level);
+            appended.append(level);
         }
     }
+    return appended;
+}
+
+quint64 LevelList::mapKey(const Level &level) const {
+    return m_symmetric ? level.packedMap().canonicalHash() : level.mapHash();
 }
 
 bool LevelList::containsLevel(QSharedPointer<Level> level) const {
-    for (int i = 0; i < size(); i++) {
-        if (*at(i) == *level) {
-            return true;
-        }
+    if (m_names.contains(qMakePair(level->m_name, level->m_author))) {
+        return true;
+    }
+
+    /* Canonical hashes are not verified, a collision of 64 bit hashes is
+       far less likely than a false duplicate by name. */
+
+    QHash<quint64, QSharedPointer<Level> >::const_iterator it = m_maps.constFind(mapKey(*level));
+    return (it != m_maps.constEnd()
+            && (m_symmetric || it.value()->packedMap() == level->packedMap()));
+}
+
+/* Incremented on language changes, levels translated for an older
+   language are retranslated on their next use. */
+static int language = 0;
+
+static QCollator &collator() {
+    static QCollator c;
+    return c;
+}
+
+Level::Level() : m_map_hash(0), m_language(-1), m_solved(false), m_solved_time(0) { }
+
+void Level::setMap(const PackedMap &map) {
+    setMap(map, LevelMetadata());
+}
+
+void Level::setMap(const PackedMap &map, const LevelMetadata &metadata) {
+    m_map = map;
+    m_map_hash = map.hash();
+    m_board_map.clear();
+    m_metadata = metadata;
+}
+
+const LevelMetadata &Level::metadata() const {
+    if (!m_metadata.isValid() && !m_map.isNull()) {
+        m_metadata = LevelMetadata(BoardMap(m_map));
     }
-    return false;
+    return m_metadata;
 }
 
-Level::Level() : m_solved(false), m_solved_time(0) { }
+QSharedPointer<BoardMap> Level::boardMap() const {
+    if (!m_board_map) {
+        m_board_map = QSharedPointer<BoardMap>(new BoardMap(m_map));
+    }
+    return m_board_map;
+}
 
 QString Level::visibleName() const
 {
@@ -68,8 +136,33 @@ QString Level::visibleName() const
 }
 
 QString Level::name() const {
+    translate();
+    return m_translated_name;
+}
+
+const QCollatorSortKey &Level::sortKey() const {
+    translate();
+    if (!m_sort_key) {
+        m_sort_key = QSharedPointer<QCollatorSortKey>(
+                    new QCollatorSortKey(collator().sortKey(m_translated_name)));
+    }
+    return *m_sort_key;
+}
+
+void Level::translate() const {
+    if (m_language == language) {
+        return;
+    }
+
     QByteArray bytes = m_name.toUtf8();
-    return i18n(bytes.constData());
+    m_translated_name = i18n(bytes.constData());
+    m_sort_key.clear();
+    m_language = language;
+}
+
+void Level::languageChanged() {
+    language++;
+    collator().setLocale(QLocale());
 }
 
 QString Level::author() const {
@@ -82,41 +175,77 @@ QString Level::key() const {
 }
 
 void Level::writeSettings(int seconds) {
-    QSharedPointer<QSettings> settings = Settings::instance()->qSettings();
-    QString k = key();
+    PresetScores::instance()->setScore(key(), seconds);
+}
 
-    settings->setValue(k, seconds);
-    settings->sync();
+void Level::readSettings() {
+    if (PresetScores::instance()->lookup(key(), &m_solved_time)) {
+        m_solved = true;
+    }
 }
 
-void Level::finalize() {
-    constructPreview();
-    readSettings();
+QImage Level::constructPreview() const {
+    /* The packed map has the bit order of Format_MonoLSB, rows can be
+       copied directly. Set bits (boxes) are black. */
+
+    QImage preview(width(), height(), QImage::Format_MonoLSB);
+    preview.setColorCount(2);
+    preview.setColor(0, qRgb(255, 255, 255));
+    preview.setColor(1, qRgb(0, 0, 0));
+
+    const int stride = m_map.stride();
+    for (int y = 0; y < height(); y++) {
+        memcpy(preview.scanLine(y), m_map.row(y), stride);
+    }
+
+    return preview;
 }
 
-void Level::readSettings() {
-    QSharedPointer<QSettings> settings = Settings::instance()->qSettings();
-    QString k = key();
+/* Previews are keyed by map content, so identical maps share their preview.
+   A null size denotes the unscaled preview. */
+struct PreviewKey
+{
+    quint64 hash;
+    QSize size;
 
-    if (settings->contains(k)) {
-        m_solved = true;
-        m_solved_time = settings->value(k).toInt();
+    bool operator==(const PreviewKey &that) const {
+        return (hash == that.hash && size == that.size);
     }
+};
+
+inline uint qHash(const PreviewKey &key) {
+    return qHash(key.hash) ^ qHash(key.size.width()) ^ (qHash(key.size.height()) << 16);
 }
 
-void Level::constructPreview() {
-    QImage preview(width(), height(), QImage::Format_Mono);
-    preview.fill(Qt::color1);
+/* The cache cost is the pixmap size in KiB. */
+static const int PREVIEW_CACHE_SIZE = 8 * 1024;
 
-    for (int y = 0; y < height(); y++) {
-        for (int x = 0; x < width(); x++) {
-            if (m_map[y * width() + x] == Board::Box) {
-                preview.setPixel(x, y, 0);
-            }
-        }
+typedef QCache<PreviewKey, QPixmap> PreviewCache;
+Q_GLOBAL_STATIC_WITH_ARGS(PreviewCache, previewCache, (PREVIEW_CACHE_SIZE))
+
+static int pixmapCost(const QPixmap &pixmap) {
+    return qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / (8 * 1024));
+}
+
+QPixmap Level::preview(const QSize &size) const {
+    PreviewKey key;
+    key.hash = m_map_hash;
+    key.size = size;
+
+    QPixmap *cached = previewCache()->object(key);
+    if (cached) {
+        return *cached;
     }
 
-    m_preview = QPixmap::fromImage(preview);
+    QPixmap pixmap;
+    if (size.isValid()) {
+        pixmap = preview().scaled(size, Qt::KeepAspectRatio, Qt::FastTransformation);
+    } else {
+        pixmap = QPixmap::fromImage(constructPreview());
+    }
+
+    previewCache()->insert(key, new QPixmap(pixmap), pixmapCost(pixmap));
+    return pixmap;
 }
 
 void Level::setSolved(int seconds) {
@@ -132,7 +261,7 @@ bool Level::operator==(const Level &that) const {
     return (that.m_name == m_name && that.m_author == m_author);
 }
 
-QList<QSharedPointer<Level> > LevelLoader::load() {
+QStringList LevelLoader::searchPaths() {
     const QString prefix = "levels/";
     QList<QString> paths;
     paths << QString(prefix)
@@ -141,174 +270,633 @@ QList<QSharedPointer<Level> > LevelLoader::load() {
                                     prefix,
                                     QStandardPaths::LocateOption::LocateDirectory);
 
-    LevelList list;
+    QStringList list;
 
     for (int i = 0; i < paths.size(); i++) {
         QDir dir(paths[i]);
-        if (!dir.exists()) {
-            continue;
+        if (!paths[i].isEmpty() && dir.exists()) {
+            list.append(dir.absolutePath());
         }
+    }
+
+    return list;
+}
+
+QStringList LevelLoader::levelsetFiles() {
+    const QStringList paths = searchPaths();
 
-        QStringList files = dir.entryList(QStringList("*.xml"));
+    QStringList list;
+
+    for (int i = 0; i < paths.size(); i++) {
+        QDir dir(paths[i]);
+
+        QStringList filters;
+        filters << "*.xml" << QString("*.xml") + COMPRESSED_SUFFIX
+                << QString("*") + LevelPack::SUFFIX
+                << QString("*") + LevelPack::SUFFIX + COMPRESSED_SUFFIX
+                << PuzzleImporter::nameFilters();
+        QStringList files = dir.entryList(filters);
 
         for (int j = 0; j < files.size(); j++) {
-            LevelLoader loader(dir.absoluteFilePath(files[j]));
-            list.append(loader.loadLevels());
+            list.append(dir.absoluteFilePath(files[j]));
         }
     }
 
     return list;
 }
 
-LevelLoader::LevelLoader(const QString &filename) :
-    m_filename(filename), m_valid(true)
+QList<QSharedPointer<Level> > LevelLoader::deduplicate(const QList<QSharedPointer<Level> > &levels,
+                                                       bool symmetric) {
+    LevelList list(symmetric);
+    list.append(levels);
+    return list;
+}
+
+QList<QSharedPointer<Level> > LevelLoader::loadLevelset(const QString &filename) {
+    try {
+        if (LevelPack::isPack(filename)) {
+            return LevelPack(filename).levels();
+        } else if (PuzzleImporter::canImport(filename)) {
+            return PuzzleImporter(filename).loadLevels();
+        }
+
+        LevelLoader loader(filename);
+        return loader.loadLevels();
+    } catch (const SystemException &e) {
+        qDebug() << "Loading levelset failed: " << e.what();
+        return QList<QSharedPointer<Level> >();
+    }
+}
+
+/* Returns the levels of a levelset from the cache if they are up to date,
+   and parses the levelset otherwise. Level packs are mapped directly and
+   never cached. */
+class CachedLevelsetLoader
 {
-    setLevelset(filename);
+public:
+    typedef QList<QSharedPointer<Level> > result_type;
+
+    CachedLevelsetLoader(const LevelCache *cache) : m_cache(cache) { }
+
+    result_type operator()(const LevelsetFile &file) const {
+        result_type levels;
+        if (LevelPack::isPack(file.path) || !m_cache->lookup(file, &levels)) {
+            levels = LevelLoader::loadLevelset(file.path);
+        }
+        return levels;
+    }
+
+private:
+    const LevelCache *m_cache;
+};
+
+static QList<LevelsetFile> statLevelsetFiles() {
+    const QStringList paths = LevelLoader::levelsetFiles();
+
+    QList<LevelsetFile> files;
+    for (int i = 0; i < paths.size(); i++) {
+        files.append(LevelsetFile(paths[i]));
+    }
+    return files;
+}
+
+/* Closes cache and rewrites it if any levelset has been parsed. */
+static void updateCache(QSharedPointer<LevelCache> &cache, const QList<LevelsetFile> &files,
+                        const QList<QList<QSharedPointer<Level> > > &levels) {
+    QList<LevelsetFile> cached_files;
+    QList<QList<QSharedPointer<Level> > > cached_levels;
+    for (int i = 0; i < files.size(); i++) {
+        if (!LevelPack::isPack(files[i].path)) {
+            cached_files.append(files[i]);
+            cached_levels.append(levels[i]);
+        }
+    }
+
+    const bool stale = cache->isStale(cached_files);
+    cache.clear();
+
+    if (stale && !LevelCache::write(LevelCache::defaultPath(), cached_files, cached_levels)) {
+        qDebug() << "Writing level cache failed";
+    }
+}
+
+QList<QSharedPointer<Level> > LevelLoader::load() {
+    const QList<LevelsetFile> files = statLevelsetFiles();
+    QSharedPointer<LevelCache> cache(new LevelCache);
+
+    QFuture<QList<QSharedPointer<Level> > > future =
+            QtConcurrent::mapped(files, CachedLevelsetLoader(cache.data()));
+
+    /* results() is ordered by levelset, not by completion. */
+
+    const QList<QList<QSharedPointer<Level> > > results = future.results();
+    updateCache(cache, files, results);
+
+    LevelList list;
+    for (int i = 0; i < results.size(); i++) {
+        list.append(results[i]);
+    }
+
+    for (int i = 0; i < list.size(); i++) {
+        list[i]->readSettings();
+    }
+
+    return list;
 }
 
-void LevelLoader::setLevelset(const QString& filename)
+AsyncLevelLoader::AsyncLevelLoader(QObject *parent) :
+    QObject(parent), m_levels(new LevelList), m_next(0), m_finished(false)
 {
-    m_levelset = QSharedPointer<QDomDocument>(new QDomDocument());
+    connect(&m_watcher, SIGNAL(resultReadyAt(int)), this, SLOT(resultReadyAt(int)));
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(watcherFinished()));
+}
 
-    QFile file(filename);
-    if (!file.open( QIODevice::ReadOnly)) {
-        throw SystemException(QString("Can't open file %1").arg(filename));
+AsyncLevelLoader::~AsyncLevelLoader() {
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+}
+
+void AsyncLevelLoader::start() {
+    m_files = statLevelsetFiles();
+    m_cache = QSharedPointer<LevelCache>(new LevelCache);
+    m_ready = QVector<bool>(m_files.size(), false);
+    m_watcher.setFuture(QtConcurrent::mapped(m_files, CachedLevelsetLoader(m_cache.data())));
+}
+
+QList<QSharedPointer<Level> > AsyncLevelLoader::levels() const {
+    return *m_levels;
+}
+
+QList<QList<QSharedPointer<Level> > > AsyncLevelLoader::levelsets() const {
+    return m_watcher.future().results();
+}
+
+void AsyncLevelLoader::resultReadyAt(int index) {
+    m_ready[index] = true;
+
+    /* Merge all levelsets which are complete up to the first missing one. */
+
+    QList<QSharedPointer<Level> > added;
+    for (; m_next < m_ready.size() && m_ready[m_next]; m_next++) {
+        added.append(m_levels->append(m_watcher.resultAt(m_next)));
     }
 
-    QString errorString;
-    int errorLine;
-    int errorColumn;
-    bool success = m_levelset->setContent( &file, false, &errorString, &errorLine, &errorColumn);
+    if (added.isEmpty()) {
+        return;
+    }
 
-    file.close();
-    if (!success) {
-        qDebug() << QString("Can't read levelset from %1 \nError: %2 in Line %3, Column %4")
-                              .arg(filename, errorString).arg(errorLine).arg(errorColumn);
-        m_valid = false;
+    for (int i = 0; i < added.size(); i++) {
+        added[i]->readSettings();
     }
+
+    emit levelsAdded(added);
 }
 
-QList<QSharedPointer<Level> > LevelLoader::loadLevels() {
-    QList<QSharedPointer<Level> > l;
+void AsyncLevelLoader::watcherFinished() {
+    if (!m_watcher.isCanceled()) {
+        updateCache(m_cache, m_files, m_watcher.future().results());
+    }
 
-    if (!m_valid) {
-        return l;
+    m_finished = true;
+    emit finished();
+}
+
+/* Changes are collected for a moment before scanning, editors tend to
+   write files in several steps. */
+static const int SCAN_DELAY_MSECS = 250;
+
+LevelLibrary::LevelLibrary(QObject *parent) :
+    QObject(parent), m_loader(new AsyncLevelLoader(this)), m_loaded(false), m_rescan(false)
+{
+    m_scan_timer.setSingleShot(true);
+    m_scan_timer.setInterval(SCAN_DELAY_MSECS);
+
+    connect(m_loader, SIGNAL(levelsAdded(QList<QSharedPointer<Level> >)),
+            this, SIGNAL(levelsAdded(QList<QSharedPointer<Level> >)));
+    connect(m_loader, SIGNAL(finished()), this, SLOT(loaderFinished()));
+    connect(&m_fs_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(pathChanged()));
+    connect(&m_fs_watcher, SIGNAL(fileChanged(QString)), this, SLOT(pathChanged()));
+    connect(&m_scan_timer, SIGNAL(timeout()), this, SLOT(scan()));
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(parsed()));
+    connect(PresetScores::instance(), SIGNAL(scoreChanged(QString,int)),
+            this, SLOT(scoreChanged(QString,int)));
+}
+
+LevelLibrary::~LevelLibrary() {
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+}
+
+LevelLibrary *LevelLibrary::instance() {
+    static QPointer<LevelLibrary> library;
+    if (!library) {
+        library = new LevelLibrary(QCoreApplication::instance());
+        library->start();
     }
+    return library;
+}
 
-    QDomElement levels = m_levelset->documentElement();
-    if (!levels.hasAttribute("name")) {
-        qDebug() << "Loading level failed: no levelset name specified";
-        return l;
+void LevelLibrary::scoreChanged(const QString &key, int seconds) {
+    Q_UNUSED(seconds);
+
+    /* The level which has been solved may stem from another load, e.g. a
+       restored game, or from a levelset parsed again since. */
+
+    QList<QSharedPointer<Level> > changed;
+    for (int i = 0; i < m_levels.size(); i++) {
+        if (m_levels[i]->key() == key) {
+            m_levels[i]->readSettings();
+            changed.append(m_levels[i]);
+        }
     }
-    m_levelsetname = levels.attribute("name");
 
-    QDomNodeList childNodes = levels.childNodes();
-    for (int i = 0; i < childNodes.size(); i++) {
-        try {
-            l.append(loadLevel(childNodes.at(i).toElement()));
-        } catch (const SystemException &e) {
-            qDebug() << "Loading level failed: " << e.what();
+    if (!changed.isEmpty()) {
+        emit levelsChanged(changed);
+    }
+}
+
+void LevelLibrary::start() {
+    /* Paths are watched right away, changes during the initial load are
+       picked up once it has finished. */
+
+    watch();
+    m_loader->start();
+}
+
+void LevelLibrary::loaderFinished() {
+    m_files = m_loader->files();
+    m_levels = m_loader->levels();
+
+    const QList<QList<QSharedPointer<Level> > > levelsets = m_loader->levelsets();
+    for (int i = 0; i < m_files.size() && i < levelsets.size(); i++) {
+        m_parsed.insert(m_files[i].path, levelsets[i]);
+    }
+
+    m_loader->deleteLater();
+    m_loader = 0;
+
+    m_loaded = true;
+    emit loaded();
+
+    if (m_rescan) {
+        scan();
+    }
+}
+
+void LevelLibrary::pathChanged() {
+    m_scan_timer.start();
+}
+
+void LevelLibrary::watch() {
+    /* Files replaced by renaming are dropped by the watcher, and new
+       directories may have appeared. */
+
+    const QStringList watched = m_fs_watcher.directories() + m_fs_watcher.files();
+
+    QStringList paths = LevelLoader::searchPaths() + LevelLoader::levelsetFiles();
+    for (int i = paths.size() - 1; i >= 0; i--) {
+        if (watched.contains(paths[i])) {
+            paths.removeAt(i);
         }
     }
-    return l;
+
+    if (!paths.isEmpty()) {
+        m_fs_watcher.addPaths(paths);
+    }
 }
 
-QSharedPointer<Level> LevelLoader::loadLevel(const QDomElement &node) const {
-    if (node.isNull() || node.tagName() != "board") {
-        throw SystemException("Unexpected level node");
+void LevelLibrary::scan() {
+    if (!m_loaded || m_watcher.isRunning()) {
+        m_rescan = true;
+        return;
     }
+    m_rescan = false;
 
-    if (!node.hasAttribute("name") || !node.hasAttribute("author")
-            || !node.hasAttribute("difficulty")) {
-        throw SystemException("Level node missing attribute.");
+    watch();
+
+    /* Files are identified by path, modification time and size. */
+
+    m_pending_files = statLevelsetFiles();
+    m_pending_paths.clear();
+    for (int i = 0; i < m_pending_files.size(); i++) {
+        if (!m_files.contains(m_pending_files[i])) {
+            m_pending_paths.append(m_pending_files[i].path);
+        }
     }
 
-    QSharedPointer<Level> p(new Level);
-    p->m_name = node.attribute("name");
-    p->m_author = node.attribute("author");
-    p->m_levelset = m_levelsetname;
-    p->m_difficulty = node.attribute("difficulty").toInt();
+    if (m_pending_paths.isEmpty()) {
+        apply(m_pending_files);
+        return;
+    }
 
-    QDomNodeList childNodes = node.childNodes();
+    m_watcher.setFuture(QtConcurrent::mapped(m_pending_paths, LevelLoader::loadLevelset));
+}
 
-    if (childNodes.isEmpty()) {
-        throw SystemException("Empty level definition.");
+void LevelLibrary::parsed() {
+    if (m_watcher.isCanceled()) {
+        return;
     }
 
-    const QString tag_name = childNodes.at(0).toElement().tagName();
-    if (tag_name == "row") {
-        int i;
-        QList<Board::State> l;
-        for (i = 0; i < childNodes.size(); i++) {
-            l = loadRow(childNodes.at(i).toElement());
-            p->m_map.append(l);
+    const QList<QList<QSharedPointer<Level> > > results = m_watcher.future().results();
+    for (int i = 0; i < m_pending_paths.size() && i < results.size(); i++) {
+        for (int j = 0; j < results[i].size(); j++) {
+            results[i][j]->readSettings();
         }
-        p->m_width = l.size();
-        p->m_height = i;
-    } else if (tag_name == "xpm") {
-        QImage xpm = openXPM(childNodes.at(0).toElement());
-        p->m_map = loadXPM(xpm);
-        p->m_width = xpm.width();
-        p->m_height = xpm.height();
+        m_parsed.insert(m_pending_paths[i], results[i]);
     }
 
-    if (p->m_map.size() != p->height() * p->width()) {
-        throw SystemException("Invalid board size");
+    apply(m_pending_files);
+
+    if (m_rescan) {
+        scan();
     }
+}
 
-    p->finalize();
+void LevelLibrary::apply(const QList<LevelsetFile> &files) {
+    /* Merging is repeated for all levelsets, since removing a levelset may
+       reveal duplicates in later ones. Levels of unchanged files are the
+       same instances as before, so comparing pointers yields the changes. */
 
-    return p;
+    QList<QList<QSharedPointer<Level> > > levelsets;
+    LevelList list;
+    for (int i = 0; i < files.size(); i++) {
+        levelsets.append(m_parsed.value(files[i].path));
+        list.append(levelsets.last());
+    }
+
+    QSet<QString> paths;
+    for (int i = 0; i < files.size(); i++) {
+        paths.insert(files[i].path);
+    }
+    for (int i = 0; i < m_files.size(); i++) {
+        if (!paths.contains(m_files[i].path)) {
+            m_parsed.remove(m_files[i].path);
+        }
+    }
+
+    const QSet<QSharedPointer<Level> > before = m_levels.toSet();
+    const QSet<QSharedPointer<Level> > after = list.toSet();
+
+    QList<QSharedPointer<Level> > removed, added;
+    for (int i = 0; i < m_levels.size(); i++) {
+        if (!after.contains(m_levels[i])) {
+            removed.append(m_levels[i]);
+        }
+    }
+    for (int i = 0; i < list.size(); i++) {
+        if (!before.contains(list[i])) {
+            added.append(list[i]);
+        }
+    }
+
+    const bool changed = !(m_files == files);
+    m_files = files;
+    m_levels = list;
+
+    if (changed) {
+        QSharedPointer<LevelCache> cache(new LevelCache);
+        updateCache(cache, m_files, levelsets);
+    }
+
+    if (!removed.isEmpty()) {
+        emit levelsRemoved(removed);
+    }
+    if (!added.isEmpty()) {
+        emit levelsAdded(added);
+    }
+}
+
+const char LevelLoader::COMPRESSED_SUFFIX[] = ".gz";
+
+LevelLoader::LevelLoader(const QString &filename) :
+    m_device(open(filename)), m_filename(filename), m_valid(true), m_started(false)
+{
+    m_reader.setDevice(m_device.data());
 }
 
-static Board::State charToState(const QChar &c) {
-    switch (c.toLatin1()) {
-    case '-': return Board::Nothing;
-    case '1': return Board::Box;
-    default: throw SystemException("Invalid char in level definition");
+QIODevice *LevelLoader::open(const QString &filename) {
+    QScopedPointer<QIODevice> device;
+    if (isCompressed(filename)) {
+        device.reset(new KCompressionDevice(new QFile(filename), true, KCompressionDevice::GZip));
+    } else {
+        device.reset(new QFile(filename));
     }
+
+    if (!device->open(QIODevice::ReadOnly)) {
+        throw SystemException(QString("Can't open file %1").arg(filename));
+    }
+    return device.take();
+}
+
+void LevelLoader::reportError() {
+    qDebug() << QString("Can't read levelset from %1 \nError: %2 in Line %3, Column %4")
+                          .arg(m_filename, m_reader.errorString())
+                          .arg(m_reader.lineNumber()).arg(m_reader.columnNumber());
 }
 
-QImage LevelLoader::openXPM(const QDomElement &node) const {
-    if (node.isNull() || node.tagName() != "xpm") {
-        throw SystemException("Unexpected row node");
+bool LevelLoader::readLevelset() {
+    if (!m_reader.readNextStartElement()) {
+        reportError();
+        return false;
     }
 
-    QFileInfo file(m_filename);
-    QString filepath = file.absolutePath() + "/" + node.text();
+    if (!m_reader.attributes().hasAttribute("name")) {
+        qDebug() << "Loading level failed: no levelset name specified";
+        return false;
+    }
+    m_levelsetname = m_reader.attributes().value("name").toString();
 
-    QImage xpm(filepath);
+    return true;
+}
+
+QSharedPointer<Level> LevelLoader::readLevel() {
+    if (!m_valid) {
+        return QSharedPointer<Level>();
+    }
+
+    if (!m_started) {
+        m_started = true;
+        if (!readLevelset()) {
+            m_valid = false;
+            return QSharedPointer<Level>();
+        }
+    }
+
+    while (m_reader.readNextStartElement()) {
+        try {
+            QSharedPointer<Level> level = loadLevel();
+            if (level) {
+                return level;
+            }
+        } catch (const SystemException &e) {
+            qDebug() << "Loading level failed: " << e.what();
+        }
+    }
 
-    if (xpm.isNull()) {
-        throw SystemException(QString("Could not load %1").arg(filepath));
+    /* Levels preceding a syntax error have already been returned. */
+
+    if (m_reader.hasError()) {
+        reportError();
     }
 
-    return xpm;
+    m_valid = false;
+    m_device->close();
+
+    return QSharedPointer<Level>();
 }
 
-QList<Board::State> LevelLoader::loadXPM(const QImage &xpm) const {
-    QList<Board::State> list;
-    for (int y = 0; y < xpm.height(); y++) {
-        for (int x = 0; x < xpm.width(); x++) {
-            QRgb pix = xpm.pixel(x, y);
-            list.append((pix == 0) ? Board::Nothing : Board::Box);
+QList<QSharedPointer<Level> > LevelLoader::loadLevels() {
+    QList<QSharedPointer<Level> > l;
+    for (QSharedPointer<Level> level = readLevel(); level; level = readLevel()) {
+        l.append(level);
+    }
+    return l;
+}
+
+QSharedPointer<Level> LevelLoader::loadLevel() {
+    /* The whole element is consumed before it is validated, which keeps the
+       reader positioned correctly if the level is rejected. */
+
+    const bool is_board = (m_reader.name() == "board");
+    const QXmlStreamAttributes attributes = m_reader.attributes();
+
+    QString first_tag;
+    QString image_path;
+    QXmlStreamAttributes image_attributes;
+    QByteArray bits, row;
+    int width = -1, height = 0;
+    const char *error = 0;
+
+    while (m_reader.readNextStartElement()) {
+        const QString tag_name = m_reader.name().toString();
+        if (first_tag.isEmpty()) {
+            first_tag = tag_name;
+        }
+
+        if (first_tag == "row") {
+            if (tag_name != "row") {
+                error = "Unexpected row node";
+                m_reader.skipCurrentElement();
+                continue;
+            }
+
+            const int row_width = loadRow(&row);
+            if (row_width < 0) {
+                error = "Invalid char in level definition";
+            } else if (width >= 0 && row_width != width) {
+                error = "Invalid board size";
+            }
+            width = row_width;
+            bits.append(row);
+            height++;
+        } else if (isImageTag(first_tag) && image_path.isEmpty()) {
+            image_attributes = m_reader.attributes();
+            image_path = m_reader.readElementText();
+        } else {
+            m_reader.skipCurrentElement();
         }
     }
 
-    return list;
+    if (m_reader.hasError()) {
+        return QSharedPointer<Level>();
+    }
+
+    if (!is_board) {
+        throw SystemException("Unexpected level node");
+    }
+
+    if (!attributes.hasAttribute("name") || !attributes.hasAttribute("author")
+            || !attributes.hasAttribute("difficulty")) {
+        throw SystemException("Level node missing attribute.");
+    }
+
+    if (first_tag.isEmpty()) {
+        throw SystemException("Empty level definition.");
+    }
+
+    if (error) {
+        throw SystemException(error);
+    }
+
+    QSharedPointer<Level> p(new Level);
+    p->m_name = attributes.value("name").toString();
+    p->m_author = attributes.value("author").toString();
+    p->m_levelset = m_levelsetname;
+    p->m_difficulty = attributes.value("difficulty").toInt();
+
+    if (first_tag == "row" && width > 0) {
+        p->setMap(PackedMap(width, height, bits));
+    } else if (isImageTag(first_tag)) {
+        p->setMap(loadImage(image_path, image_attributes));
+    }
+
+    if (p->m_map.isNull()) {
+        throw SystemException("Invalid board size");
+    }
+
+    return p;
 }
 
-QList<Board::State> LevelLoader::loadRow(const QDomElement &node) const {
-    if (node.isNull() || node.tagName() != "row") {
-        throw SystemException("Unexpected row node");
+bool LevelLoader::isImageTag(const QString &tag) {
+    return (tag == "xpm" || tag == "image");
+}
+
+PackedMap LevelLoader::loadImage(const QString &path,
+                                 const QXmlStreamAttributes &attributes) const {
+    /* Images are relative to the levelset. The optional "threshold" and
+       "dither" attributes control the conversion of greyscale images. */
+
+    ImageImporter importer;
+    if (attributes.hasAttribute("threshold")) {
+        const int threshold = attributes.value("threshold").toInt();
+        if (threshold <= 0 || threshold >= 256) {
+            throw SystemException("Invalid image threshold");
+        }
+        importer.setThreshold(threshold);
+    }
+    if (attributes.value("dither") == "true") {
+        importer.setMode(ImageImporter::Dither);
     }
 
-    QString text = node.text();
-    QList<Board::State> list;
-    foreach (const QChar &c, text) {
-        Board::State s = charToState(c);
-        list.append(s);
+    QFileInfo file(m_filename);
+    return importer.load(file.absolutePath() + "/" + path);
+}
+
+int LevelLoader::loadRow(QByteArray *row) {
+    /* Packs the text of the current <row> element straight into row
+       (see PackedMap) and returns its length, or -1 if it contains
+       invalid characters. */
+
+    row->clear();
+    int count = 0;
+    bool valid = true;
+
+    while (!m_reader.atEnd()) {
+        const QXmlStreamReader::TokenType token = m_reader.readNext();
+        if (token == QXmlStreamReader::EndElement) {
+            break;
+        } else if (token == QXmlStreamReader::StartElement) {
+            valid = false;
+            m_reader.skipCurrentElement();
+            continue;
+        } else if (token != QXmlStreamReader::Characters) {
+            continue;
+        }
+
+        const QStringRef text = m_reader.text();
+        const QChar *chars = text.unicode();
+        for (int i = 0; i < text.size(); i++, count++) {
+            if (count % 8 == 0) {
+                row->append('\0');
+            }
+
+            switch (chars[i].unicode()) {
+            case '-': break;
+            case '1': row->data()[count / 8] |= (1 << (count % 8)); break;
+            default: valid = false;
+            }
+        }
     }
 
-    return list;
+    return valid ? count : -1;
 }
@@ -19,77 +19,282 @@
 #ifndef LEVELLOADER_H
 #define LEVELLOADER_H
 
+#include <QCollator>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QList>
+#include <QObject>
 #include <QPixmap>
+#include <QScopedPointer>
 #include <QString>
 #include <QSharedPointer>
+#include <QTimer>
+#include <QXmlStreamReader>
 
 #include "src/logic/board.h"
+#include "src/logic/boardmap.h"
+#include "src/logic/levelmetadata.h"
+#include "src/logic/packedmap.h"
 
-class QDomDocument;
-class QDomElement;
+#include "src/logic/levelcache.h"
+
+class AsyncLevelLoader;
+class LevelList;
 class LevelLoader;
 
 class Level
 {
+    friend class AsyncLevelLoader;
+    friend class ImageImporter;
+    friend class LevelCache;
+    friend class LevelLibrary;
+    friend class LevelList;
     friend class LevelLoader;
+    friend class LevelPack;
+    friend class PuzzleImporter;
 public:
     Level();
 
+    /* returns the translated name. translations are cached until the next
+       call to languageChanged(), which makes this accessible from the GUI
+       thread only */
     QString name() const;
     QString author() const;
     QString levelset() const { return m_levelset; }
     int difficulty() const { return m_difficulty; }
-    int width() const { return m_width; }
-    int height() const { return m_height; }
-    QList<Board::State> map() const { return m_map; }
-    QPixmap preview() const { return m_preview; }
+    int width() const { return m_map.width(); }
+    int height() const { return m_map.height(); }
+    QList<Board::State> map() const { return m_map.toList(); }
+    const PackedMap &packedMap() const { return m_map; }
+    quint64 mapHash() const { return m_map_hash; }
+
+    /* returns the solution as a board sharing packedMap(). the board and its
+       clues are created on first use and shared by all games started from
+       this level, which makes this accessible from the GUI thread only */
+    QSharedPointer<BoardMap> boardMap() const;
+
+    /* returns the solution as a black and white image, scaled to fit into
+       size if it is valid. previews are built on first use and cached, which
+       makes this accessible from the GUI thread only */
+    QPixmap preview(const QSize &size = QSize()) const;
+
+    /* returns the properties of the map. unless they have been read from
+       the level cache or a level pack, they are computed on first use,
+       which makes this accessible from the GUI thread only */
+    const LevelMetadata &metadata() const;
 
     QString visibleName() const;
+
+    /* returns a key ordering levels by name according to the collation
+       rules of the current locale. computed on first use and cached like
+       the translated name */
+    const QCollatorSortKey &sortKey() const;
+
+    /* invalidates the cached names and sort keys of all levels. must be
+       called whenever the application language changes */
+    static void languageChanged();
+
     bool solved() const { return m_solved; }
     int solvedTime() const { return m_solved_time; }
     void setSolved(int seconds);
 
     bool operator==(const Level &that) const;
 
+    /* returns a string uniquely identifying this level */
+    QString key() const;
+
 private:
-    void finalize(); /* needs to be called by loader when done constructing */
-    void constructPreview();
+    /* sets the map. without metadata, it is analyzed by metadata() */
+    void setMap(const PackedMap &map);
+    void setMap(const PackedMap &map, const LevelMetadata &metadata);
+    QImage constructPreview() const;
+    void translate() const;
     void readSettings();
     void writeSettings(int seconds);
-    QString key() const;
 
     QString m_name, m_author, m_levelset;
     int m_difficulty;
-    int m_width, m_height;
-    QList<Board::State> m_map;
+    PackedMap m_map;
+    quint64 m_map_hash;
+    mutable QSharedPointer<BoardMap> m_board_map;
+    mutable LevelMetadata m_metadata;
+    mutable QString m_translated_name;
+    mutable QSharedPointer<QCollatorSortKey> m_sort_key;
+    mutable int m_language;
     bool m_solved;
     int m_solved_time;
-    QPixmap m_preview;
 };
 
+/* Reads levelsets incrementally with a QXmlStreamReader. Levels are
+   available as soon as their <board> element has been parsed, the document
+   is never held in memory as a whole. Levelsets ending in .gz are
+   decompressed while they are parsed. */
 class LevelLoader
 {
 public:
+    /* throws SystemException if filename cannot be opened */
     LevelLoader(const QString &filename);
 
+    /* returns the next level of the levelset, or a null pointer once all
+       levels have been read. invalid levels are skipped */
+    QSharedPointer<Level> readLevel();
+
+    /* parses all levels of the levelset. the levels' solved state is not
+       read, which allows calling this from any thread */
     QList<QSharedPointer<Level> > loadLevels();
+
+    /* loads the levels of all levelsets found in the level search paths.
+       levelsets are taken from the level cache if they have not been
+       modified, and are parsed in parallel otherwise */
     static QList<QSharedPointer<Level> > load();
 
+    /* returns the existing level directories in load order */
+    static QStringList searchPaths();
+
+    /* returns the levelset files of all search paths in load order */
+    static QStringList levelsetFiles();
+
+    /* removes duplicate levels, keeping the first occurrence. levels are
+       duplicates if they have the same name and author, or the same map.
+       if symmetric is set, maps which are rotations or reflections of each
+       other are considered the same */
+    static QList<QSharedPointer<Level> > deduplicate(const QList<QSharedPointer<Level> > &levels,
+                                                     bool symmetric);
+
+    /* loads all levels of a levelset file, level pack or puzzle file in
+       a format supported by PuzzleImporter. never throws */
+    static QList<QSharedPointer<Level> > loadLevelset(const QString &filename);
+
+    /* opens filename for reading. gzip compressed files, recognized by
+       COMPRESSED_SUFFIX, are decompressed on the fly. the caller owns the
+       returned device. throws SystemException if filename cannot be opened */
+    static QIODevice *open(const QString &filename);
+
+    static bool isCompressed(const QString &filename) { return filename.endsWith(COMPRESSED_SUFFIX); }
+
+    static const char COMPRESSED_SUFFIX[];
+
 private:
-    void setLevelset(const QString& levelname);
-    QSharedPointer<Level> loadLevel(const QDomElement &node) const;
-    QList<Board::State> loadRow(const QDomElement &node) const;
-    QImage openXPM(const QDomElement &node) const;
-    QList<Board::State> loadXPM(const QImage &xpm) const;
+    bool readLevelset();
+    QSharedPointer<Level> loadLevel();
+    int loadRow(QByteArray *row);
+    static bool isImageTag(const QString &tag);
+    PackedMap loadImage(const QString &path, const QXmlStreamAttributes &attributes) const;
+    void reportError();
 
-    QSharedPointer<QDomDocument> m_levelset;
+    QScopedPointer<QIODevice> m_device;
+    QXmlStreamReader m_reader;
     QString m_levelsetname;
 
     const QString m_filename;
 
     bool m_valid;
+    bool m_started;
+};
+
+/* Loads the same levels as LevelLoader::load() on worker threads without
+   blocking the caller. Levelsets are merged in load order, so the result is
+   deterministic; levels are announced as soon as their levelset and all
+   preceding ones have been parsed. */
+class AsyncLevelLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AsyncLevelLoader(QObject *parent = 0);
+
+    /* cancels loading and waits for running workers */
+    virtual ~AsyncLevelLoader();
+
+    void start();
+    bool isFinished() const { return m_finished; }
+
+    /* returns all levels announced so far */
+    QList<QSharedPointer<Level> > levels() const;
+
+    /* return the levelset files and the levels parsed from each of them,
+       including duplicates. only valid once finished */
+    QList<LevelsetFile> files() const { return m_files; }
+    QList<QList<QSharedPointer<Level> > > levelsets() const;
+
+signals:
+    void levelsAdded(const QList<QSharedPointer<Level> > &levels);
+    void finished();
+
+private slots:
+    void resultReadyAt(int index);
+    void watcherFinished();
+
+private:
+    QFutureWatcher<QList<QSharedPointer<Level> > > m_watcher;
+    QList<LevelsetFile> m_files;
+    QSharedPointer<LevelCache> m_cache;
+    QSharedPointer<LevelList> m_levels;
+    QVector<bool> m_ready;
+    int m_next;
+    bool m_finished;
+};
+
+/* The levels of all search paths, kept up to date while the program runs.
+   After the initial load, the search paths and levelset files are watched.
+   Only added or modified files are parsed again, and only the levels which
+   actually changed are announced. Solved states follow the scores set
+   through Level::setSolved(), including those of other Level instances with
+   the same key. */
+class LevelLibrary : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LevelLibrary(QObject *parent = 0);
+
+    /* cancels parsing and waits for running workers */
+    virtual ~LevelLibrary();
+
+    /* returns the library shared by the application, which is created and
+       started on first use and destroyed together with the application */
+    static LevelLibrary *instance();
+
+    /* loads all levels like AsyncLevelLoader, then starts watching */
+    void start();
+    bool isLoaded() const { return m_loaded; }
+
+    /* returns the current levels in load order */
+    QList<QSharedPointer<Level> > levels() const { return m_levels; }
+
+signals:
+    void levelsAdded(const QList<QSharedPointer<Level> > &levels);
+    void levelsRemoved(const QList<QSharedPointer<Level> > &levels);
+    /* emitted when the solved state of levels has changed */
+    void levelsChanged(const QList<QSharedPointer<Level> > &levels);
+    void loaded();
+
+private slots:
+    void loaderFinished();
+    void scoreChanged(const QString &key, int seconds);
+    void pathChanged();
+    void scan();
+    void parsed();
+
+private:
+    void watch();
+    void apply(const QList<LevelsetFile> &files);
+
+    AsyncLevelLoader *m_loader;
+    QFileSystemWatcher m_fs_watcher;
+    QTimer m_scan_timer;
+    QFutureWatcher<QList<QSharedPointer<Level> > > m_watcher;
+
+    QList<LevelsetFile> m_files;
+    QHash<QString, QList<QSharedPointer<Level> > > m_parsed;
+    QList<QSharedPointer<Level> > m_levels;
+
+    /* the state of the search paths while m_watcher parses the changes */
+    QList<LevelsetFile> m_pending_files;
+    QStringList m_pending_paths;
+
+    bool m_loaded;
+    bool m_rescan;
 };
 
 #endif // LEVELLOADER_H
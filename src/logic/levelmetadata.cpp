@@ -0,0 +1,131 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "levelmetadata.h"
+
+#include "boardmap.h"
+#include "solver.h"
+
+/* Metadata is computed for every level written to the level cache, so
+   solving is bounded. Each guess copies the board, the number of guesses
+   allowed therefore shrinks with the board size, and the largest boards
+   are not solved. */
+static const int MAX_GUESSES = 100;
+static const int MAX_GUESSED_CELLS = 100 * 32 * 32;
+static const int MAX_SOLVED_CELLS = 64 * 64;
+
+static int digitCount(int value) {
+    int digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+LevelMetadata::LevelMetadata() :
+    boxes(0), cells(0), clues(0), max_clue(0), row_text_length(0),
+    col_clue_count(0), wide_row(-1), wide_digit_row(-1), tall_col(-1),
+    guesses(-1), unique(false) { }
+
+LevelMetadata::LevelMetadata(const BoardMap &map, bool solve) :
+    boxes(map.boxCount()), cells(map.width() * map.height()), clues(0),
+    max_clue(0), row_text_length(0), col_clue_count(0), wide_row(-1),
+    wide_digit_row(-1), tall_col(-1), guesses(-1), unique(false)
+{
+    QVector<QVector<int> > rows(map.height()), cols(map.width());
+    int row_digits = 0;
+
+    for (int y = 0; y < map.height(); y++) {
+        const QVector<int> &line = map.rowClues(y);
+        rows[y] = line;
+
+        int digits = 0;
+        for (int i = 0; i < line.size(); i++) {
+            digits += digitCount(line[i]);
+            max_clue = qMax(max_clue, line[i]);
+        }
+        clues += line.size();
+
+        /* Clues are separated by a space. */
+
+        const int length = digits + qMax(0, line.size() - 1);
+        if (length > row_text_length) {
+            row_text_length = length;
+            wide_row = y;
+        }
+        if (digits > row_digits) {
+            row_digits = digits;
+            wide_digit_row = y;
+        }
+    }
+
+    for (int x = 0; x < map.width(); x++) {
+        const QVector<int> &line = map.colClues(x);
+        cols[x] = line;
+
+        for (int i = 0; i < line.size(); i++) {
+            max_clue = qMax(max_clue, line[i]);
+        }
+        clues += line.size();
+
+        if (line.size() > col_clue_count) {
+            col_clue_count = line.size();
+            tall_col = x;
+        }
+    }
+
+    if (!solve || cells > MAX_SOLVED_CELLS) {
+        return;
+    }
+
+    Solver solver(rows, cols);
+    const Solver::Result result = solver.solve(qMin(MAX_GUESSES, MAX_GUESSED_CELLS / cells));
+    unique = (result == Solver::Unique);
+    if (result != Solver::Aborted) {
+        guesses = solver.guesses();
+    }
+}
+
+QDataStream &operator<<(QDataStream &out, const LevelMetadata &metadata) {
+    out << (qint32)metadata.boxes << (qint32)metadata.cells << (qint32)metadata.clues
+        << (qint32)metadata.max_clue << (qint32)metadata.row_text_length
+        << (qint32)metadata.col_clue_count << (qint32)metadata.wide_row
+        << (qint32)metadata.wide_digit_row << (qint32)metadata.tall_col
+        << (qint32)metadata.guesses << metadata.unique;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, LevelMetadata &metadata) {
+    qint32 values[10];
+    for (int i = 0; i < 10; i++) {
+        in >> values[i];
+    }
+    in >> metadata.unique;
+
+    metadata.boxes = values[0];
+    metadata.cells = values[1];
+    metadata.clues = values[2];
+    metadata.max_clue = values[3];
+    metadata.row_text_length = values[4];
+    metadata.col_clue_count = values[5];
+    metadata.wide_row = values[6];
+    metadata.wide_digit_row = values[7];
+    metadata.tall_col = values[8];
+    metadata.guesses = values[9];
+    return in;
+}
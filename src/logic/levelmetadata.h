@@ -0,0 +1,64 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef LEVELMETADATA_H
+#define LEVELMETADATA_H
+
+#include <QDataStream>
+
+class BoardMap;
+
+/* Properties of a level's map used for sorting and filtering, and for
+   sizing the streak areas. They are computed once when a level is imported
+   and stored along with it in the level cache and in level packs. */
+struct LevelMetadata
+{
+    /* creates invalid metadata */
+    LevelMetadata();
+
+    /* analyzes map. if solve is set, the clues are solved as well, which is
+       by far the most expensive part. maps of more than 64 * 64 cells are
+       not solved */
+    explicit LevelMetadata(const BoardMap &map, bool solve = true);
+
+    bool isValid() const { return cells > 0; }
+
+    /* returns the fraction of cells which are boxes */
+    double density() const { return isValid() ? (double)boxes / cells : 0.0; }
+
+    int boxes;
+    int cells;
+    int clues;              /* total number of row and column clues */
+    int max_clue;           /* the longest streak */
+
+    /* The row clue text with the most characters, e.g. "1 12 3", and the
+       column with the most clues determine the size of the streak areas.
+       Digits are wider than spaces, the row with the most digits is
+       kept as well. Lines are -1 if the map has no clues at all. */
+    int row_text_length;
+    int col_clue_count;
+    int wide_row, wide_digit_row, tall_col;
+
+    int guesses;            /* guesses needed by Solver, -1 if unknown or
+                               the search was not finished */
+    bool unique;            /* the clues have a single solution */
+};
+
+QDataStream &operator<<(QDataStream &out, const LevelMetadata &metadata);
+QDataStream &operator>>(QDataStream &in, LevelMetadata &metadata);
+
+#endif // LEVELMETADATA_H
@@ -0,0 +1,270 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#include "levelpack.h"
+
+#include <KCompressionDevice>
+#include <QBuffer>
+#include <QDebug>
+#include <QHash>
+#include <QSaveFile>
+#include <QtEndian>
+#include <string.h>
+
+#include "levelloader.h"
+#include "src/systemexception.h"
+
+const char LevelPack::SUFFIX[] = ".pmpack";
+
+static const char MAGIC[] = { 'P', 'M', 'P', 'K' };
+static const quint32 VERSION = 1;
+static const int HEADER_SIZE = 64;
+static const int RECORD_SIZE = 40;
+static const int METADATA_RECORD_SIZE = 64;
+
+LevelPack::LevelPack(const QString &path) :
+    m_data(0), m_size(0)
+{
+    if (LevelLoader::isCompressed(path)) {
+        QScopedPointer<QIODevice> device(LevelLoader::open(path));
+        QBuffer *buffer = new QBuffer;
+        m_owner = QSharedPointer<QObject>(buffer);
+        buffer->setData(device->readAll());
+
+        m_size = buffer->data().size();
+        if (m_size >= HEADER_SIZE) {
+            m_data = reinterpret_cast<const uchar *>(buffer->data().constData());
+        }
+    } else {
+        QFile *file = new QFile(path);
+        m_owner = QSharedPointer<QObject>(file);
+        if (!file->open(QIODevice::ReadOnly)) {
+            throw SystemException(QString("Can't open file %1").arg(path));
+        }
+
+        m_size = file->size();
+        if (m_size >= HEADER_SIZE) {
+            m_data = file->map(0, m_size);
+        }
+    }
+
+    if (!m_data || memcmp(m_data, MAGIC, sizeof(MAGIC)) != 0
+            || qFromLittleEndian<quint32>(m_data + 4) != VERSION) {
+        throw SystemException(QString("%1 is not a level pack").arg(path));
+    }
+
+    m_count = qFromLittleEndian<quint32>(m_data + 8);
+    m_record_size = qFromLittleEndian<quint32>(m_data + 12);
+    m_records_offset = qFromLittleEndian<quint64>(m_data + 16);
+    m_strings_offset = qFromLittleEndian<quint64>(m_data + 24);
+    m_strings_size = qFromLittleEndian<quint64>(m_data + 32);
+    m_maps_offset = qFromLittleEndian<quint64>(m_data + 40);
+    m_maps_size = qFromLittleEndian<quint64>(m_data + 48);
+
+    /* Newer versions may append fields to records, but not remove any. */
+
+    if (m_record_size < RECORD_SIZE
+            || m_records_offset > m_size
+            || (quint64)m_count * m_record_size > m_size - m_records_offset
+            || m_strings_offset > m_size || m_strings_size > m_size - m_strings_offset
+            || m_maps_offset > m_size || m_maps_size > m_size - m_maps_offset) {
+        throw SystemException(QString("Corrupt level pack %1").arg(path));
+    }
+}
+
+bool LevelPack::isPack(const QString &path) {
+    return path.endsWith(SUFFIX) || path.endsWith(QString(SUFFIX) + LevelLoader::COMPRESSED_SUFFIX);
+}
+
+QString LevelPack::string(quint64 offset) const {
+    if (offset > m_strings_size || m_strings_size - offset < 4) {
+        throw SystemException("Corrupt level pack string");
+    }
+
+    const uchar *p = m_data + m_strings_offset + offset;
+    const quint32 length = qFromLittleEndian<quint32>(p);
+    if (length > m_strings_size - offset - 4) {
+        throw SystemException("Corrupt level pack string");
+    }
+
+    return QString::fromUtf8(reinterpret_cast<const char *>(p + 4), length);
+}
+
+static int line(quint16 value) {
+    return (value == 0xffff) ? -1 : value;
+}
+
+QSharedPointer<Level> LevelPack::level(int i) const {
+    const uchar *record = m_data + m_records_offset + (quint64)i * m_record_size;
+
+    const quint64 map_offset = qFromLittleEndian<quint64>(record);
+    const quint64 hash = qFromLittleEndian<quint64>(record + 8);
+    const int width = qFromLittleEndian<quint16>(record + 28);
+    const int height = qFromLittleEndian<quint16>(record + 30);
+
+    const quint64 map_size = (quint64)height * PackedMap::stride(width);
+    if (width == 0 || height == 0 || map_offset > m_maps_size
+            || map_size > m_maps_size - map_offset) {
+        throw SystemException("Corrupt level pack record");
+    }
+
+    QSharedPointer<Level> p(new Level);
+    p->m_name = string(qFromLittleEndian<quint32>(record + 16));
+    p->m_author = string(qFromLittleEndian<quint32>(record + 20));
+    p->m_levelset = string(qFromLittleEndian<quint32>(record + 24));
+    p->m_difficulty = qFromLittleEndian<qint32>(record + 32);
+
+    /* Levels of older packs analyze their maps on first use. */
+
+    LevelMetadata metadata;
+    if (m_record_size >= METADATA_RECORD_SIZE) {
+        metadata.boxes = qFromLittleEndian<quint32>(record + 40);
+        metadata.cells = width * height;
+        metadata.clues = qFromLittleEndian<quint32>(record + 44);
+        metadata.max_clue = qFromLittleEndian<quint16>(record + 48);
+        metadata.row_text_length = qFromLittleEndian<quint16>(record + 50);
+        metadata.col_clue_count = qFromLittleEndian<quint16>(record + 52);
+        metadata.wide_row = line(qFromLittleEndian<quint16>(record + 54));
+        metadata.wide_digit_row = line(qFromLittleEndian<quint16>(record + 56));
+        metadata.tall_col = line(qFromLittleEndian<quint16>(record + 58));
+        metadata.guesses = qFromLittleEndian<qint16>(record + 60);
+        metadata.unique = (qFromLittleEndian<quint16>(record + 62) & 1);
+    }
+
+    p->setMap(PackedMap::fromRawData(width, height,
+                                     reinterpret_cast<const char *>(m_data + m_maps_offset + map_offset),
+                                     m_owner),
+              metadata);
+
+    if (p->m_map_hash != hash) {
+        throw SystemException("Corrupt level pack map");
+    }
+
+    return p;
+}
+
+QList<QSharedPointer<Level> > LevelPack::levels() const {
+    QList<QSharedPointer<Level> > l;
+    l.reserve(m_count);
+    for (quint32 i = 0; i < m_count; i++) {
+        try {
+            l.append(level(i));
+        } catch (const SystemException &e) {
+            qDebug() << "Loading level failed: " << e.what();
+        }
+    }
+    return l;
+}
+
+template <typename T>
+static void append(QByteArray *bytes, T value) {
+    uchar buf[sizeof(T)];
+    qToLittleEndian<T>(value, buf);
+    bytes->append(reinterpret_cast<const char *>(buf), sizeof(T));
+}
+
+bool LevelPack::write(const QString &path, const QList<QSharedPointer<Level> > &levels) {
+    QByteArray records, strings, maps;
+    QHash<QString, quint32> string_offsets;
+
+    for (int i = 0; i < levels.size(); i++) {
+        const Level *l = levels[i].data();
+        if (l->width() > 0xffff || l->height() > 0xffff) {
+            return false;
+        }
+
+        /* Authors and levelsets repeat, store each string once. */
+
+        const QString fields[] = { l->m_name, l->m_author, l->m_levelset };
+        quint32 field_offsets[3];
+        for (int j = 0; j < 3; j++) {
+            QHash<QString, quint32>::const_iterator it = string_offsets.constFind(fields[j]);
+            if (it != string_offsets.constEnd()) {
+                field_offsets[j] = it.value();
+                continue;
+            }
+
+            const QByteArray utf8 = fields[j].toUtf8();
+            field_offsets[j] = strings.size();
+            string_offsets.insert(fields[j], strings.size());
+            append<quint32>(&strings, utf8.size());
+            strings.append(utf8);
+        }
+
+        append<quint64>(&records, maps.size());
+        append<quint64>(&records, l->m_map_hash);
+        for (int j = 0; j < 3; j++) {
+            append<quint32>(&records, field_offsets[j]);
+        }
+        append<quint16>(&records, l->width());
+        append<quint16>(&records, l->height());
+        append<qint32>(&records, l->m_difficulty);
+        append<quint32>(&records, 0);
+
+        const LevelMetadata &metadata = l->metadata();
+        append<quint32>(&records, metadata.boxes);
+        append<quint32>(&records, metadata.clues);
+        append<quint16>(&records, qMin(metadata.max_clue, 0xffff));
+        append<quint16>(&records, qMin(metadata.row_text_length, 0xffff));
+        append<quint16>(&records, qMin(metadata.col_clue_count, 0xffff));
+        append<quint16>(&records, (metadata.wide_row < 0) ? 0xffff : metadata.wide_row);
+        append<quint16>(&records, (metadata.wide_digit_row < 0) ? 0xffff : metadata.wide_digit_row);
+        append<quint16>(&records, (metadata.tall_col < 0) ? 0xffff : metadata.tall_col);
+        append<qint16>(&records, qMin(metadata.guesses, 0x7fff));
+        append<quint16>(&records, metadata.unique ? 1 : 0);
+
+        maps.append(l->m_map.bits());
+    }
+
+    QByteArray header(MAGIC, sizeof(MAGIC));
+    append<quint32>(&header, VERSION);
+    append<quint32>(&header, levels.size());
+    append<quint32>(&header, METADATA_RECORD_SIZE);
+    append<quint64>(&header, HEADER_SIZE);
+    append<quint64>(&header, HEADER_SIZE + records.size());
+    append<quint64>(&header, strings.size());
+    append<quint64>(&header, HEADER_SIZE + records.size() + strings.size());
+    append<quint64>(&header, maps.size());
+    append<quint64>(&header, 0);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QScopedPointer<QIODevice> compressor;
+    QIODevice *out = &file;
+    if (LevelLoader::isCompressed(path)) {
+        compressor.reset(new KCompressionDevice(&file, false, KCompressionDevice::GZip));
+        if (!compressor->open(QIODevice::WriteOnly)) {
+            return false;
+        }
+        out = compressor.data();
+    }
+
+    out->write(header);
+    out->write(records);
+    out->write(strings);
+    out->write(maps);
+
+    if (compressor) {
+        compressor->close();
+    }
+
+    return file.commit();
+}
@@ -0,0 +1,98 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#ifndef LEVELPACK_H
+#define LEVELPACK_H
+
+#include <QFile>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+class Level;
+
+/* A read-only, memory-mapped collection of levels for libraries too large to
+   be loaded from XML. All integers are little endian:
+
+   header (64 bytes)
+       0  "PMPK"
+       4  u32 version
+       8  u32 level count
+      12  u32 record size
+      16  u64 records offset, u64 strings offset, u64 strings size,
+          u64 maps offset, u64 maps size, u64 reserved
+
+   record (one per level, record size bytes)
+       0  u64 map offset (relative to maps), u64 map hash (PackedMap::hash())
+      16  u32 name, u32 author, u32 levelset (relative to strings)
+      28  u16 width, u16 height, i32 difficulty, u32 reserved
+      40  u32 boxes, u32 clues, u16 max clue, u16 row text length,
+          u16 column clue count, u16 wide row, u16 wide digit row,
+          u16 tall column, i16 guesses, u16 flags (1: unique)
+
+   the fields at 40 and later hold the LevelMetadata and are missing in
+   packs written by older versions. values which do not fit are clamped,
+   lines without clues are stored as 0xffff.
+
+   strings are stored as u32 byte count followed by UTF-8, maps as in
+   PackedMap. Levels handed out by a pack refer to its mapping instead of
+   copying their maps.
+
+   Packs may be gzip compressed for distribution (SUFFIX followed by
+   LevelLoader::COMPRESSED_SUFFIX). These are decompressed into memory
+   once, which their levels then refer to. */
+class LevelPack
+{
+public:
+    /* maps the pack at path. throws SystemException if it is not a valid
+       level pack */
+    explicit LevelPack(const QString &path);
+
+    /* returns true if path names a pack, compressed or not */
+    static bool isPack(const QString &path);
+
+    int count() const { return m_count; }
+
+    /* 0 <= i < count(). throws SystemException if the record is corrupt */
+    QSharedPointer<Level> level(int i) const;
+
+    /* returns all levels, skipping corrupt records */
+    QList<QSharedPointer<Level> > levels() const;
+
+    /* writes levels to a new pack at path, compressing it if path names a
+       compressed pack */
+    static bool write(const QString &path, const QList<QSharedPointer<Level> > &levels);
+
+    static const char SUFFIX[];
+
+private:
+    QString string(quint64 offset) const;
+
+    /* the mapped file or the decompressed pack */
+    QSharedPointer<QObject> m_owner;
+    const uchar *m_data;
+    quint64 m_size;
+
+    quint32 m_count;
+    quint32 m_record_size;
+    quint64 m_records_offset;
+    quint64 m_strings_offset, m_strings_size;
+    quint64 m_maps_offset, m_maps_size;
+};
+
+#endif // LEVELPACK_H
@@ -0,0 +1,194 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#include "packedmap.h"
+
+#include "src/outofboundsexception.h"
+#include "src/systemexception.h"
+
+PackedMap::PackedMap() : m_width(0), m_height(0) { }
+
+PackedMap::PackedMap(int width, int height) :
+    m_width(width), m_height(height), m_bits(height * stride(width), '\0')
+{
+}
+
+PackedMap::PackedMap(int width, int height, const QByteArray &bits) :
+    m_width(width), m_height(height), m_bits(bits)
+{
+    const int row_stride = stride();
+    if (m_bits.size() != height * row_stride) {
+        throw SystemException("Invalid packed map size");
+    }
+
+    /* Clear the padding bits. This only detaches if any were set. */
+
+    const int padding = row_stride * 8 - width;
+    if (padding == 0) {
+        return;
+    }
+
+    const uchar mask = 0xff >> padding;
+    for (int y = 0; y < height; y++) {
+        const int i = y * row_stride + row_stride - 1;
+        if (static_cast<uchar>(m_bits.at(i)) & ~mask) {
+            m_bits.data()[i] &= mask;
+        }
+    }
+}
+
+PackedMap PackedMap::fromRawData(int width, int height, const char *data,
+                                 QSharedPointer<QObject> owner) {
+    PackedMap map;
+    map.m_width = width;
+    map.m_height = height;
+    map.m_bits = QByteArray::fromRawData(data, height * stride(width));
+    map.m_owner = owner;
+    return map;
+}
+
+void PackedMap::assertInbounds(int x, int y) const {
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+        throw OutOfBoundsException();
+    }
+}
+
+Board::State PackedMap::get(int x, int y) const {
+    assertInbounds(x, y);
+    const uchar byte = row(y)[x / 8];
+    return (byte & (1 << (x % 8))) ? Board::Box : Board::Nothing;
+}
+
+void PackedMap::set(int x, int y, Board::State state) {
+    assertInbounds(x, y);
+
+    /* data() copies raw data, which then no longer needs its owner. */
+
+    char *byte = m_bits.data() + y * stride() + x / 8;
+    m_owner.clear();
+
+    if (state == Board::Box) {
+        *byte |= (1 << (x % 8));
+    } else {
+        *byte &= ~(1 << (x % 8));
+    }
+}
+
+const uchar *PackedMap::row(int y) const {
+    return reinterpret_cast<const uchar *>(m_bits.constData()) + y * stride();
+}
+
+int PackedMap::boxCount() const {
+    const uchar *bytes = reinterpret_cast<const uchar *>(m_bits.constData());
+    int count = 0;
+    for (int i = 0; i < m_bits.size(); i++) {
+        for (uchar b = bytes[i]; b != 0; b &= b - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+quint64 PackedMap::hash() const {
+    quint64 h = Q_UINT64_C(14695981039346656037);
+    const quint64 prime = Q_UINT64_C(1099511628211);
+
+    h = (h ^ (quint64)m_width) * prime;
+    h = (h ^ (quint64)m_height) * prime;
+
+    const uchar *bytes = reinterpret_cast<const uchar *>(m_bits.constData());
+    for (int i = 0; i < m_bits.size(); i++) {
+        h = (h ^ bytes[i]) * prime;
+    }
+
+    return h;
+}
+
+/* Stores the coordinates of the cell which is moved to (x, y) by t
+   in a map of size w * h into sx, sy. */
+static void sourceCell(PackedMap::Transform t, int w, int h, int x, int y, int *sx, int *sy) {
+    switch (t % 4) {
+    case 0: *sx = x; *sy = y; break;
+    case 1: *sx = y; *sy = h - 1 - x; break;
+    case 2: *sx = w - 1 - x; *sy = h - 1 - y; break;
+    case 3: *sx = w - 1 - y; *sy = x; break;
+    }
+
+    if (t >= PackedMap::Mirror) {
+        *sx = w - 1 - *sx;
+    }
+}
+
+quint64 PackedMap::hash(Transform t) const {
+    if (t == Identity) {
+        return hash();
+    }
+
+    const bool swapped = (t % 2 == 1);
+    const int width = swapped ? m_height : m_width;
+    const int height = swapped ? m_width : m_height;
+
+    quint64 h = Q_UINT64_C(14695981039346656037);
+    const quint64 prime = Q_UINT64_C(1099511628211);
+
+    h = (h ^ (quint64)width) * prime;
+    h = (h ^ (quint64)height) * prime;
+
+    /* Assemble the transformed rows byte by byte, exactly as they would be
+       stored. */
+
+    for (int y = 0; y < height; y++) {
+        for (int x0 = 0; x0 < width; x0 += 8) {
+            uchar byte = 0;
+            for (int x = x0; x < x0 + 8 && x < width; x++) {
+                int sx, sy;
+                sourceCell(t, m_width, m_height, x, y, &sx, &sy);
+                if (row(sy)[sx / 8] & (1 << (sx % 8))) {
+                    byte |= (1 << (x - x0));
+                }
+            }
+            h = (h ^ byte) * prime;
+        }
+    }
+
+    return h;
+}
+
+quint64 PackedMap::canonicalHash() const {
+    quint64 h = hash();
+    for (int t = Identity + 1; t < TransformCount; t++) {
+        h = qMin(h, hash(static_cast<Transform>(t)));
+    }
+    return h;
+}
+
+QList<Board::State> PackedMap::toList() const {
+    QList<Board::State> list;
+    list.reserve(m_width * m_height);
+    for (int y = 0; y < m_height; y++) {
+        const uchar *bytes = row(y);
+        for (int x = 0; x < m_width; x++) {
+            list.append((bytes[x / 8] & (1 << (x % 8))) ? Board::Box : Board::Nothing);
+        }
+    }
+    return list;
+}
+
+bool PackedMap::operator==(const PackedMap &that) const {
+    return (m_width == that.m_width && m_height == that.m_height && m_bits == that.m_bits);
+}
@@ -0,0 +1,112 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#ifndef PACKEDMAP_H
+#define PACKEDMAP_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QList>
+#include <QSharedPointer>
+
+#include "board.h"
+
+/* A compact, implicitly shared solution map. Each row occupies stride()
+   bytes; cell x of a row is stored in bit (x % 8) of byte (x / 8), and a set
+   bit denotes a Box. Unused bits at the end of each row are always zero, so
+   maps can be compared and hashed through bits(). */
+class PackedMap
+{
+public:
+    /* the symmetries of a map: clockwise rotations by multiples of 90
+       degrees, applied after an optional horizontal reflection */
+    enum Transform {
+        Identity,
+        Rotate90,
+        Rotate180,
+        Rotate270,
+        Mirror,
+        MirrorRotate90,
+        MirrorRotate180,
+        MirrorRotate270,
+        TransformCount /* not a real transform */
+    };
+
+    /* creates a null map */
+    PackedMap();
+
+    /* creates a map without boxes. 0 < width, height */
+    PackedMap(int width, int height);
+
+    /* creates a map from its packed representation, bits must contain
+       height * stride(width) bytes */
+    PackedMap(int width, int height, const QByteArray &bits);
+
+    /* creates a map referring to height * stride(width) bytes at data
+       without copying them. the padding bits of data must be zero. data
+       has to stay valid while owner is alive, a reference to which is held
+       by the map and all copies of it. */
+    static PackedMap fromRawData(int width, int height, const char *data,
+                                 QSharedPointer<QObject> owner);
+
+    bool isNull() const { return m_width == 0; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    /* returns the number of bytes per row */
+    int stride() const { return stride(m_width); }
+    static int stride(int width) { return (width + 7) / 8; }
+
+    /* 0 <= x < width(); 0 <= y < height(). states other than Box are
+       stored as Nothing */
+    Board::State get(int x, int y) const;
+    void set(int x, int y, Board::State state);
+
+    /* returns a pointer to the stride() bytes of row y */
+    const uchar *row(int y) const;
+
+    const QByteArray &bits() const { return m_bits; }
+
+    /* returns the total box count */
+    int boxCount() const;
+
+    /* returns a 64 bit FNV-1a hash of the dimensions and bits */
+    quint64 hash() const;
+
+    /* returns hash() of the map transformed by t without constructing it */
+    quint64 hash(Transform t) const;
+
+    /* returns the smallest hash of all transforms, which is the same for
+       maps that are rotations or reflections of each other */
+    quint64 canonicalHash() const;
+
+    /* returns the map as a row-major list of states */
+    QList<Board::State> toList() const;
+
+    bool operator==(const PackedMap &that) const;
+    bool operator!=(const PackedMap &that) const { return !(*this == that); }
+
+private:
+    void assertInbounds(int x, int y) const;
+
+    int m_width, m_height;
+    QByteArray m_bits;
+    QSharedPointer<QObject> m_owner;
+};
+
+#endif // PACKEDMAP_H
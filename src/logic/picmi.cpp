@@ -16,7 +16,6 @@
  ************************************************************************* */
 
 
-#include "config.h"
 #include "picmi.h"
 
 #include <assert.h>
@@ -83,27 +82,16 @@ void IOHandlerHints::setBox(int x, int y) {
     }
 }
 
-Picmi::Picmi()
+Picmi::Picmi(int width, int height, double density, bool prevent_mistakes) :
+    Picmi(QSharedPointer<BoardMap>(new BoardMap(width, height, density)), prevent_mistakes)
 {
-    int width, height;
-    double density;
-    bool prevent_mistakes;
-
-    switch (Settings::instance()->level()) {
-    case KgDifficultyLevel::Easy: width = height = 10; density = 0.55; prevent_mistakes = false; break;
-    case KgDifficultyLevel::Medium: width = 15; height = 10; density = 0.55; prevent_mistakes = false; break;
-    case KgDifficultyLevel::Hard: width = height = 15; density = 0.55; prevent_mistakes = false; break;
-    case KgDifficultyLevel::Custom:
-    default:
-        width = Settings::instance()->width();
-        height = Settings::instance()->height();
-        density = Settings::instance()->boxDensity();
-        prevent_mistakes = Settings::instance()->preventMistakes();
-        break;
-    }
+}
 
-    m_map = QSharedPointer<BoardMap>(new BoardMap(width, height, density));
-    m_state = QSharedPointer<BoardState>(new BoardState(width, height));
+Picmi::Picmi(QSharedPointer<BoardMap> board, bool prevent_mistakes) :
+    m_prevent_mistakes(prevent_mistakes)
+{
+    m_map = board;
+    m_state = QSharedPointer<BoardState>(new BoardState(board->width(), board->height()));
     m_streaks = QSharedPointer<Streaks>(new Streaks(m_map, m_state));
 
     if (prevent_mistakes) {
@@ -117,16 +105,6 @@ Picmi::Picmi()
     setupSlots();
 }
 
-Picmi::Picmi(QSharedPointer<BoardMap> board) {
-    m_map = board;
-    m_state = QSharedPointer<BoardState>(new BoardState(board->width(), board->height()));
-    m_streaks = QSharedPointer<Streaks>(new Streaks(m_map, m_state));
-    m_io_handler = QSharedPointer<IOHandler>(new IOHandlerNoHints(m_map.data(), m_state.data(), &m_timer));
-    m_timer.start();
-
-    setupSlots();
-}
-
 void Picmi::setupSlots()
 {
     connect(m_state.data(), SIGNAL(undoStackSizeChanged(int)), this, SIGNAL(undoStackSizeChanged(int)));
@@ -161,6 +139,7 @@ bool Picmi::won() const {
 }
 
 QPoint Picmi::undo() {
+    record(SessionEvent::Undo);
     QPoint coord = m_state->undo();
     m_streaks->update();
     emit stateChanged();
@@ -188,16 +167,35 @@ QPoint Picmi::hint()
 
     const int idx = rand() % incorrect_cells.size();
     const QPoint cell(incorrect_cells.at(idx));
+    hintAt(cell);
+    return cell;
+}
+
+void Picmi::hintAt(const QPoint &cell)
+{
+    record(SessionEvent::Hint, cell);
+
     Board::State state = m_map->get(cell.x(), cell.y());
     if (state == Board::Nothing) {
         state = Board::Cross;
     }
 
-    /* Clear the state in order to ensure the subsequent setState succeeds. */
+    /* Clear the state in order to ensure the subsequent applyState succeeds. */
     m_state->set(cell.x(), cell.y(), Board::Nothing);
-    setState(cell.x(), cell.y(), state);
+    applyState(cell.x(), cell.y(), state);
     m_timer.addPenaltyTime();
-    return cell;
+}
+
+void Picmi::loadState() {
+    record(SessionEvent::LoadState);
+    m_state->loadState();
+    m_streaks->update();
+    emit stateChanged();
+}
+
+void Picmi::saveState() {
+    record(SessionEvent::SaveState);
+    m_state->saveState();
 }
 
 void Picmi::solve() {
@@ -207,15 +205,8 @@ void Picmi::solve() {
     emit gameCompleted();
 }
 
-KScoreDialog::FieldInfo Picmi::endGame() {
+void Picmi::endGame() {
     m_timer.stop();
-
-    KScoreDialog::FieldInfo score;
-    score[KScoreDialog::Score].setNum(m_timer.elapsedSecs());
-    score[KScoreDialog::Time] = Time(m_timer.elapsedSecs()).toString();
-    score[KScoreDialog::Date] = m_timer.startDate().toString("dd MMM yyyy hh:mm");
-
-    return score;
 }
 
 int Picmi::height() const {
@@ -238,7 +229,16 @@ int Picmi::elapsedSecs() const {
     return m_timer.elapsedSecs();
 }
 
+QDateTime Picmi::startDate() const {
+    return m_timer.startDate();
+}
+
 void Picmi::setState(int x, int y, Board::State state) {
+    record(SessionEvent::SetState, QPoint(x, y), state);
+    applyState(x, y, state);
+}
+
+void Picmi::applyState(int x, int y, Board::State state) {
     m_io_handler->set(x, y, state);
     m_streaks->update(x, y);
     emit stateChanged();
@@ -256,3 +256,32 @@ QVector<Streaks::Streak> Picmi::getRowStreak(int y) const {
 QVector<Streaks::Streak> Picmi::getColStreak(int x) const {
     return m_streaks->getColStreak(x);
 }
+
+void Picmi::setRecorder(QSharedPointer<SessionRecorder> recorder) {
+    m_recorder = recorder;
+    if (m_recorder && !m_recorder->isStarted()) {
+        m_recorder->begin(*m_map, m_prevent_mistakes);
+    }
+}
+
+void Picmi::saveSnapshot(QDataStream &out) const {
+    m_state->save(out);
+    m_timer.save(out);
+}
+
+bool Picmi::restoreSnapshot(QDataStream &in) {
+    if (!m_state->restore(in)) {
+        return false;
+    }
+    m_timer.restore(in);
+    m_streaks->update();
+    emit stateChanged();
+
+    return (in.status() == QDataStream::Ok);
+}
+
+void Picmi::record(SessionEvent::Type type, const QPoint &pos, Board::State state) {
+    if (m_recorder) {
+        m_recorder->record(type, pos, state);
+    }
+}
@@ -19,12 +19,10 @@
 #ifndef PICMI_H
 #define PICMI_H
 
-#include <highscore/kscoredialog.h>
-
 #include "boardmap.h"
 #include "boardstate.h"
 #include "elapsedtime.h"
-#include "src/settings.h"
+#include "sessionlog.h"
 #include "streaks.h"
 
 /* Moved from picmi.cpp to work around QSharedPointer issues with forward declarations.
@@ -51,13 +49,15 @@ class Picmi : public QObject
     Q_OBJECT
 public:
 
-    Picmi();
-    Picmi(QSharedPointer<BoardMap> board);
+    /* creates a random board. 0 < width, height; 0.0 < density < 1.0 */
+    Picmi(int width, int height, double density, bool prevent_mistakes);
+    Picmi(QSharedPointer<BoardMap> board, bool prevent_mistakes = false);
 
     int width() const;
     int height() const;
     int remainingBoxCount() const { return m_map->boxCount() - m_state->boxCount(); }
     QSharedPointer<BoardMap> getBoardMap() const { return m_map; }
+    bool preventMistakes() const { return m_prevent_mistakes; }
     bool outOfBounds(int x, int y) const;
 
     /* 0 <= x < width(); 0 <= y < height() */
@@ -66,9 +66,10 @@ public:
 
     void setPaused(bool paused);
     int elapsedSecs() const;
+    QDateTime startDate() const;
 
-    /* ends the current game and returns the current high score object */
-    KScoreDialog::FieldInfo endGame();
+    /* ends the current game by stopping the timer */
+    void endGame();
 
     /* undo last action (if it exists) and return the changed coordinate. */
     QPoint undo();
@@ -76,13 +77,19 @@ public:
     /* Uncovers a single, random, still uncovered cell. */
     QPoint hint();
 
+    /* Uncovers the given cell exactly like hint() does. Used when replaying
+       recorded sessions, since hint() itself is not deterministic. */
+    void hintAt(const QPoint &cell);
+
     /* Solves the entire board, but does not emit the gameWon signal. */
     void solve();
 
     /* if a saved state exists, load it. otherwise, do nothing */
-    void loadState() { m_state->loadState(); m_streaks->update(); emit stateChanged(); }
-    void saveState() { m_state->saveState(); }
+    void loadState();
+    void saveState();
     int currentStateAge() const { return m_state->currentStateAge(); }
+    int undoStackSize() const { return m_state->undoStackSize(); }
+    int saveStackSize() const { return m_state->saveStackSize(); }
 
     /* returns the request row/col streak. these contain the least information required by
       the frontend, which is (for each position within a streak): "which number is this",
@@ -90,6 +97,22 @@ public:
     QVector<Streaks::Streak> getRowStreak(int y) const;
     QVector<Streaks::Streak> getColStreak(int x) const;
 
+    /* Records all subsequent actions to recorder, which receives the log
+       header immediately unless it has already been started (for example
+       when resuming a journal). Pass a null pointer to stop recording. */
+    void setRecorder(QSharedPointer<SessionRecorder> recorder);
+
+    /* Serializes the board state, undo history and timer. The map itself is
+       not included. */
+    void saveSnapshot(QDataStream &out) const;
+
+    /* Restores a snapshot written by saveSnapshot() for the same map.
+       Returns false if the snapshot is invalid. */
+    bool restoreSnapshot(QDataStream &in);
+
+    /* adds secs to the elapsed game time */
+    void addElapsedSecs(int secs) { m_timer.addTime(secs); }
+
 signals:
     /** Emitted when the game has been completed in any way. Also triggered if "Solve" was used. */
     void gameCompleted();
@@ -113,13 +136,21 @@ private:
 
     void setupSlots();
 
+    /* sets the cell state through the io handler and updates streaks */
+    void applyState(int x, int y, Board::State state);
+
+    void record(SessionEvent::Type type, const QPoint &pos = QPoint(),
+                Board::State state = Board::Nothing);
+
 private:
     QSharedPointer<BoardMap> m_map;
     QSharedPointer<BoardState> m_state;
     QSharedPointer<IOHandler> m_io_handler;
     QSharedPointer<Streaks> m_streaks;
+    QSharedPointer<SessionRecorder> m_recorder;
 
     ElapsedTime m_timer;
+    bool m_prevent_mistakes;
 };
 
 #endif // PICMI_H
@@ -0,0 +1,97 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#include "presetscores.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QSettings>
+
+#include "src/settings.h"
+
+static const char GROUP[] = "preset_scores";
+
+/* Delay in ms after which new scores are written. */
+static const int FLUSH_DELAY = 2000;
+
+PresetScores::PresetScores(QObject *parent) : QObject(parent)
+{
+    QSharedPointer<QSettings> settings = Settings::instance()->qSettings();
+
+    settings->beginGroup(GROUP);
+    const QStringList keys = settings->allKeys();
+    for (int i = 0; i < keys.size(); i++) {
+        m_scores.insert(QString("%1/%2").arg(GROUP, keys[i]), settings->value(keys[i]).toInt());
+    }
+    settings->endGroup();
+
+    m_flush_timer.setSingleShot(true);
+    m_flush_timer.setInterval(FLUSH_DELAY);
+    connect(&m_flush_timer, SIGNAL(timeout()), this, SLOT(flush()));
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(flush()));
+    }
+}
+
+PresetScores *PresetScores::instance() {
+    /* Owned by the application. Pending scores are written on aboutToQuit(),
+       while the settings can still be used. */
+    static QPointer<PresetScores> scores;
+    if (!scores) {
+        scores = new PresetScores(QCoreApplication::instance());
+    }
+    return scores;
+}
+
+bool PresetScores::lookup(const QString &key, int *seconds) const {
+    QHash<QString, int>::const_iterator it = m_scores.constFind(key);
+    if (it == m_scores.constEnd()) {
+        return false;
+    }
+
+    *seconds = it.value();
+    return true;
+}
+
+void PresetScores::setScore(const QString &key, int seconds) {
+    m_scores.insert(key, seconds);
+    m_pending.insert(key, seconds);
+
+    if (!m_flush_timer.isActive()) {
+        m_flush_timer.start();
+    }
+
+    emit scoreChanged(key, seconds);
+}
+
+void PresetScores::flush() {
+    m_flush_timer.stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    QSharedPointer<QSettings> settings = Settings::instance()->qSettings();
+    for (QHash<QString, int>::const_iterator it = m_pending.constBegin();
+         it != m_pending.constEnd(); ++it) {
+        settings->setValue(it.key(), it.value());
+    }
+    settings->sync();
+
+    m_pending.clear();
+}
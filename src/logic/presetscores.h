@@ -0,0 +1,60 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+#ifndef PRESETSCORES_H
+#define PRESETSCORES_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+/* The best times of all preset levels. The preset_scores settings group is
+   read once into memory on first use. New scores are collected and written
+   to the settings in a single batch shortly afterwards, or at the latest when
+   the application quits. Not thread-safe. */
+class PresetScores : public QObject
+{
+    Q_OBJECT
+public:
+    static PresetScores *instance();
+
+    /* if a score is stored for key (see Level::key()), stores it in
+       seconds and returns true */
+    bool lookup(const QString &key, int *seconds) const;
+
+    /* sets the score of key and schedules writing it */
+    void setScore(const QString &key, int seconds);
+
+public slots:
+    /* writes all pending scores immediately */
+    void flush();
+
+signals:
+    void scoreChanged(const QString &key, int seconds);
+
+private:
+    explicit PresetScores(QObject *parent);
+    Q_DISABLE_COPY(PresetScores)
+
+    QHash<QString, int> m_scores;
+    QHash<QString, int> m_pending;
+    QTimer m_flush_timer;
+};
+
+#endif // PRESETSCORES_H
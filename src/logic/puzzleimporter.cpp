@@ -0,0 +1,490 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "puzzleimporter.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QXmlStreamReader>
+
+#include "levelloader.h"
+#include "solver.h"
+#include "src/systemexception.h"
+
+/* Larger puzzles are rejected before anything is allocated for them. */
+static const int MAX_PUZZLE_SIZE = 256;
+
+/* throws SystemException unless size is a valid puzzle width or height */
+static void validateSize(int size) {
+    if (size <= 0 || size > MAX_PUZZLE_SIZE) {
+        throw SystemException("Invalid puzzle size");
+    }
+}
+
+/* Parses a clue line such as "3 1 2" or "3,1,2". Zeros denote an empty
+   line and are dropped. */
+static QVector<int> parseClues(const QString &text) {
+    QVector<int> clues;
+    const QStringList numbers = QString(text).replace(',', ' ').simplified()
+                                .split(' ', QString::SkipEmptyParts);
+    for (int i = 0; i < numbers.size(); i++) {
+        bool ok;
+        const int n = numbers[i].toInt(&ok);
+        if (!ok || n < 0) {
+            throw SystemException(QString("Invalid clue '%1'").arg(numbers[i]));
+        }
+        if (n > 0) {
+            clues.append(n);
+        }
+    }
+    return clues;
+}
+
+/* throws SystemException unless puzzle has sane dimensions and either a
+   solution or clues that fit into their lines */
+static void validate(const Puzzle &puzzle) {
+    validateSize(puzzle.width);
+    validateSize(puzzle.height);
+
+    if (!puzzle.solution.isNull()) {
+        if (puzzle.solution.width() != puzzle.width
+                || puzzle.solution.height() != puzzle.height) {
+            throw SystemException("Solution does not match puzzle size");
+        }
+        return;
+    }
+
+    if (puzzle.rows.size() != puzzle.height || puzzle.cols.size() != puzzle.width) {
+        throw SystemException("Clue count does not match puzzle size");
+    }
+
+    for (int i = 0; i < puzzle.rows.size() + puzzle.cols.size(); i++) {
+        const bool is_row = (i < puzzle.rows.size());
+        const QVector<int> &clues = is_row ? puzzle.rows[i] : puzzle.cols[i - puzzle.rows.size()];
+        int length = clues.size() - 1;
+        for (int j = 0; j < clues.size(); j++) {
+            length += clues[j];
+        }
+        if (length > (is_row ? puzzle.width : puzzle.height)) {
+            throw SystemException("Clues do not fit into line");
+        }
+    }
+}
+
+/* Reads the webpbn XML format. Only two color puzzles are supported. A
+   file may contain a <puzzleset> of many puzzles, each of which is
+   parsed as soon as it is reached. */
+class WebpbnReader : public PuzzleReader
+{
+public:
+    explicit WebpbnReader(QIODevice *device) : m_reader(device) { }
+
+    bool read(Puzzle *puzzle) {
+        while (!m_reader.atEnd()) {
+            if (m_reader.readNext() == QXmlStreamReader::StartElement
+                    && m_reader.name() == "puzzle") {
+                readPuzzle(puzzle);
+                return true;
+            }
+        }
+
+        if (m_reader.hasError()) {
+            qDebug() << "Parsing webpbn puzzle failed:" << m_reader.errorString();
+        }
+        return false;
+    }
+
+private:
+    void readPuzzle(Puzzle *puzzle) {
+        /* As in LevelLoader, the whole element is consumed before it is
+           validated. */
+
+        const QXmlStreamAttributes attributes = m_reader.attributes();
+        const QString default_color = attributes.hasAttribute("defaultcolor")
+                ? attributes.value("defaultcolor").toString() : "black";
+        const QString background = attributes.hasAttribute("backgroundcolor")
+                ? attributes.value("backgroundcolor").toString() : "white";
+
+        QHash<QString, QChar> chars;
+        chars["black"] = 'X';
+        chars["white"] = '.';
+
+        QString image;
+        const char *error = 0;
+
+        if (attributes.hasAttribute("type") && attributes.value("type") != "grid") {
+            error = "Unsupported puzzle type";
+        }
+
+        while (m_reader.readNextStartElement()) {
+            const QStringRef name = m_reader.name();
+            if (name == "title") {
+                puzzle->title = m_reader.readElementText().simplified();
+            } else if (name == "author") {
+                puzzle->author = m_reader.readElementText().simplified();
+            } else if (name == "color") {
+                const QString color = m_reader.attributes().value("name").toString();
+                const QString c = m_reader.attributes().value("char").toString();
+                if (c.size() == 1) {
+                    chars[color] = c[0];
+                }
+                m_reader.skipCurrentElement();
+            } else if (name == "clues") {
+                const bool rows = (m_reader.attributes().value("type") == "rows");
+                QVector<QVector<int> > &lines = rows ? puzzle->rows : puzzle->cols;
+                lines.clear();
+                if (!readClues(&lines, default_color)) {
+                    error = "Unsupported clue color";
+                }
+            } else if (name == "solution" && image.isEmpty()
+                       && m_reader.attributes().value("type") != "saved") {
+                while (m_reader.readNextStartElement()) {
+                    if (m_reader.name() == "image") {
+                        image = m_reader.readElementText();
+                    } else {
+                        m_reader.skipCurrentElement();
+                    }
+                }
+            } else {
+                m_reader.skipCurrentElement();
+            }
+        }
+
+        if (m_reader.hasError()) {
+            throw SystemException(m_reader.errorString());
+        } else if (error) {
+            throw SystemException(error);
+        }
+
+        puzzle->height = puzzle->rows.size();
+        puzzle->width = puzzle->cols.size();
+
+        if (!image.isEmpty()) {
+            puzzle->solution = parseImage(image, chars.value(background));
+            puzzle->width = puzzle->solution.width();
+            puzzle->height = puzzle->solution.height();
+        }
+    }
+
+    /* reads the <line> elements of a <clues> element. returns false if a
+       count has a color other than default_color */
+    bool readClues(QVector<QVector<int> > *lines, const QString &default_color) {
+        bool valid = true;
+        while (m_reader.readNextStartElement()) {
+            if (m_reader.name() != "line") {
+                m_reader.skipCurrentElement();
+                continue;
+            }
+
+            QVector<int> clues;
+            while (m_reader.readNextStartElement()) {
+                if (m_reader.name() != "count") {
+                    m_reader.skipCurrentElement();
+                    continue;
+                }
+
+                const QXmlStreamAttributes attributes = m_reader.attributes();
+                if (attributes.hasAttribute("color")
+                        && attributes.value("color") != default_color) {
+                    valid = false;
+                }
+                clues += parseClues(m_reader.readElementText());
+            }
+            lines->append(clues);
+        }
+        return valid;
+    }
+
+    /* parses an image such as "|X.X|\n|.X.|", where cells other than the
+       background are boxes */
+    static PackedMap parseImage(const QString &image, QChar background) {
+        QStringList rows = image.split('\n', QString::SkipEmptyParts);
+        for (int i = 0; i < rows.size(); i++) {
+            rows[i] = rows[i].trimmed().remove('|');
+        }
+        rows.removeAll(QString());
+
+        if (rows.isEmpty() || rows[0].isEmpty()) {
+            throw SystemException("Empty solution image");
+        }
+
+        validateSize(rows[0].size());
+        validateSize(rows.size());
+
+        PackedMap map(rows[0].size(), rows.size());
+        for (int y = 0; y < rows.size(); y++) {
+            if (rows[y].size() != map.width()) {
+                throw SystemException("Invalid solution image");
+            }
+            for (int x = 0; x < map.width(); x++) {
+                if (rows[y][x] == '?') {
+                    throw SystemException("Incomplete solution image");
+                } else if (rows[y][x] != background) {
+                    map.set(x, y, Board::Box);
+                }
+            }
+        }
+        return map;
+    }
+
+    QXmlStreamReader m_reader;
+};
+
+/* Base class of line oriented formats holding a single puzzle. */
+class LineReader : public PuzzleReader
+{
+public:
+    explicit LineReader(QIODevice *device) : m_device(device), m_done(false) { }
+
+    bool read(Puzzle *puzzle) {
+        if (m_done) {
+            return false;
+        }
+        m_done = true;
+        readPuzzle(puzzle);
+        return true;
+    }
+
+protected:
+    virtual void readPuzzle(Puzzle *puzzle) = 0;
+
+    /* reads the next line, returning false at the end of the input */
+    bool readLine(QString *line) {
+        if (m_device->atEnd()) {
+            return false;
+        }
+        *line = QString::fromUtf8(m_device->readLine()).trimmed();
+        return true;
+    }
+
+private:
+    QIODevice *m_device;
+    bool m_done;
+};
+
+/* Reads the .non format: keyword lines such as 'title "..."', 'width 10',
+   followed after 'rows' and 'columns' by one clue line per line of the
+   puzzle. An optional 'goal' holds the solution as a string of 0 and 1. */
+class NonReader : public LineReader
+{
+public:
+    explicit NonReader(QIODevice *device) : LineReader(device) { }
+
+protected:
+    void readPuzzle(Puzzle *puzzle) {
+        QString line, goal;
+        while (readLine(&line)) {
+            if (line.isEmpty() || line.startsWith('#')) {
+                continue;
+            }
+
+            const QString keyword = line.section(' ', 0, 0);
+            const QString value = unquote(line.section(' ', 1).trimmed());
+
+            if (keyword == "title") {
+                puzzle->title = value;
+            } else if (keyword == "by" || keyword == "author") {
+                puzzle->author = value;
+            } else if (keyword == "width") {
+                puzzle->width = value.toInt();
+                validateSize(puzzle->width);
+            } else if (keyword == "height") {
+                puzzle->height = value.toInt();
+                validateSize(puzzle->height);
+            } else if (keyword == "rows") {
+                readLines(&puzzle->rows, puzzle->height);
+            } else if (keyword == "columns") {
+                readLines(&puzzle->cols, puzzle->width);
+            } else if (keyword == "goal") {
+                goal = value;
+            }
+        }
+
+        if (!goal.isEmpty()) {
+            puzzle->solution = parseGoal(goal, puzzle->width, puzzle->height);
+        }
+    }
+
+private:
+    static QString unquote(const QString &s) {
+        if (s.size() >= 2 && s.startsWith('"') && s.endsWith('"')) {
+            return s.mid(1, s.size() - 2);
+        }
+        return s;
+    }
+
+    /* reads count clue lines, where empty lines denote empty lines */
+    void readLines(QVector<QVector<int> > *lines, int count) {
+        if (count <= 0) {
+            throw SystemException("Clues precede puzzle size");
+        }
+
+        QString line;
+        lines->clear();
+        while (lines->size() < count && readLine(&line)) {
+            lines->append(parseClues(line));
+        }
+    }
+
+    static PackedMap parseGoal(const QString &goal, int width, int height) {
+        validateSize(width);
+        validateSize(height);
+        if (goal.size() != width * height) {
+            throw SystemException("Invalid goal");
+        }
+
+        PackedMap map(width, height);
+        for (int i = 0; i < goal.size(); i++) {
+            if (goal[i] == '1') {
+                map.set(i % width, i / width, Board::Box);
+            } else if (goal[i] != '0') {
+                throw SystemException("Invalid goal");
+            }
+        }
+        return map;
+    }
+};
+
+/* Reads .cwc clue files: the height and the width on a line each,
+   followed by a line of space separated clues for every row and then
+   every column. Empty lines are written as 0. */
+class CwcReader : public LineReader
+{
+public:
+    explicit CwcReader(QIODevice *device) : LineReader(device) { }
+
+protected:
+    void readPuzzle(Puzzle *puzzle) {
+        QString line;
+        while (readLine(&line)) {
+            if (line.isEmpty()) {
+                continue;
+            }
+
+            if (puzzle->height == 0) {
+                puzzle->height = line.toInt();
+                validateSize(puzzle->height);
+            } else if (puzzle->width == 0) {
+                puzzle->width = line.toInt();
+                validateSize(puzzle->width);
+            } else if (puzzle->rows.size() < puzzle->height) {
+                puzzle->rows.append(parseClues(line));
+            } else if (puzzle->cols.size() < puzzle->width) {
+                puzzle->cols.append(parseClues(line));
+            } else {
+                throw SystemException("Trailing data");
+            }
+        }
+    }
+};
+
+PuzzleReader *PuzzleReader::create(const QString &path, QIODevice *device) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "pbn") {
+        return new WebpbnReader(device);
+    } else if (suffix == "non") {
+        return new NonReader(device);
+    } else if (suffix == "cwc") {
+        return new CwcReader(device);
+    }
+    return 0;
+}
+
+PuzzleImporter::PuzzleImporter(const QString &filename)
+    : m_file(filename), m_levelset(QFileInfo(filename).completeBaseName()), m_count(0)
+{
+    m_reader.reset(PuzzleReader::create(filename, &m_file));
+    if (!m_reader) {
+        throw SystemException(QString("Unsupported puzzle format: %1").arg(filename));
+    }
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        throw SystemException(QString("Can't open file %1").arg(filename));
+    }
+}
+
+PuzzleImporter::~PuzzleImporter()
+{
+}
+
+bool PuzzleImporter::canImport(const QString &filename) {
+    const QString suffix = QFileInfo(filename).suffix().toLower();
+    return (suffix == "pbn" || suffix == "non" || suffix == "cwc");
+}
+
+QStringList PuzzleImporter::nameFilters() {
+    return QStringList() << "*.pbn" << "*.non" << "*.cwc";
+}
+
+QSharedPointer<Level> PuzzleImporter::readLevel() {
+    while (m_file.isOpen()) {
+        Puzzle puzzle;
+        try {
+            if (!m_reader->read(&puzzle)) {
+                m_file.close();
+                break;
+            }
+            m_count++;
+            return toLevel(puzzle);
+        } catch (const SystemException &e) {
+            qDebug() << "Skipping puzzle in" << m_file.fileName() << ":" << e.what();
+        }
+    }
+
+    return QSharedPointer<Level>();
+}
+
+QList<QSharedPointer<Level> > PuzzleImporter::loadLevels() {
+    QList<QSharedPointer<Level> > l;
+    for (QSharedPointer<Level> level = readLevel(); level; level = readLevel()) {
+        l.append(level);
+    }
+    return l;
+}
+
+QSharedPointer<Level> PuzzleImporter::toLevel(const Puzzle &puzzle) const {
+    validate(puzzle);
+
+    PackedMap map = puzzle.solution;
+    int guesses = 0;
+
+    if (map.isNull()) {
+        Solver solver(puzzle.rows, puzzle.cols);
+        const Solver::Result result = solver.solve();
+        map = solver.solution();
+        guesses = solver.guesses();
+
+        if (map.isNull()) {
+            throw SystemException(result == Solver::Aborted ? "Puzzle too hard to solve"
+                                                            : "Puzzle has no solution");
+        }
+    }
+
+    QSharedPointer<Level> level(new Level);
+    level->m_name = puzzle.title.isEmpty() ? QString("%1 %2").arg(m_levelset).arg(m_count)
+                                           : puzzle.title;
+    level->m_author = puzzle.author.isEmpty() ? QString("Unknown") : puzzle.author;
+    level->m_levelset = m_levelset;
+
+    /* Rated on the 1 to 6 scale of the default levels by size, and harder
+       if line solving alone does not suffice. */
+    level->m_difficulty = qBound(1, 1 + map.width() * map.height() / 200 + (guesses > 0 ? 2 : 0), 6);
+
+    level->setMap(map);
+    return level;
+}
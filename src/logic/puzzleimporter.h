@@ -0,0 +1,94 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef PUZZLEIMPORTER_H
+#define PUZZLEIMPORTER_H
+
+#include <QFile>
+#include <QList>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "src/logic/packedmap.h"
+
+class Level;
+
+/* A puzzle read from an external format. Clue-only puzzles have a null
+   solution. */
+struct Puzzle
+{
+    Puzzle() : width(0), height(0) { }
+
+    QString title, author;
+    int width, height;
+    QVector<QVector<int> > rows, cols;
+    PackedMap solution;
+};
+
+/* Reads puzzles one at a time from a device, so memory use depends on the
+   size of a single puzzle rather than that of the file. */
+class PuzzleReader
+{
+public:
+    virtual ~PuzzleReader() { }
+
+    /* reads the next puzzle and returns true, or returns false at the end
+       of the input or on errors the reader can't recover from. throws
+       SystemException if only the current puzzle is invalid, after which
+       reading may continue */
+    virtual bool read(Puzzle *puzzle) = 0;
+
+    /* returns a reader for the format indicated by the suffix of path, or
+       a null pointer. the reader does not take ownership of device */
+    static PuzzleReader *create(const QString &path, QIODevice *device);
+};
+
+/* Imports puzzles from the webpbn XML format (.pbn), the .non format and
+   .cwc clue files as levels. Puzzles without a solution are solved from
+   their clues. */
+class PuzzleImporter
+{
+public:
+    /* throws SystemException if filename can't be opened or has an
+       unsupported format */
+    explicit PuzzleImporter(const QString &filename);
+    ~PuzzleImporter();
+
+    static bool canImport(const QString &filename);
+
+    /* returns the file patterns of supported formats */
+    static QStringList nameFilters();
+
+    /* returns the next level, or a null pointer once all puzzles have been
+       read. invalid and unsolvable puzzles are skipped */
+    QSharedPointer<Level> readLevel();
+
+    QList<QSharedPointer<Level> > loadLevels();
+
+private:
+    QSharedPointer<Level> toLevel(const Puzzle &puzzle) const;
+
+    QFile m_file;
+    QScopedPointer<PuzzleReader> m_reader;
+    const QString m_levelset;
+    int m_count;
+};
+
+#endif // PUZZLEIMPORTER_H
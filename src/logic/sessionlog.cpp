@@ -0,0 +1,336 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "sessionlog.h"
+
+#include <QIODevice>
+#include <QList>
+#include <limits.h>
+
+#include "boardmap.h"
+#include "picmi.h"
+
+static const char MAGIC[] = { 'P', 'M', 'S', 'L' };
+static const int MAGIC_SIZE = sizeof(MAGIC);
+static const char VERSION = 2;
+
+enum {
+    FLAG_PREVENT_MISTAKES = 1 << 0
+};
+
+/* Each event starts with a single byte storing the event type in the
+   lower three bits and the cell state in the next two bits. */
+static const int TYPE_MASK = 0x07;
+static const int STATE_SHIFT = 3;
+static const int STATE_MASK = 0x03;
+
+static void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append((char)value);
+}
+
+static quint64 zigzag(qint64 value)
+{
+    return ((quint64)value << 1) ^ (quint64)(value >> 63);
+}
+
+static qint64 unzigzag(quint64 value)
+{
+    return (qint64)(value >> 1) ^ -(qint64)(value & 1);
+}
+
+quint64 SessionRecorder::hash(const BoardMap &map)
+{
+    return map.packedMap().hash();
+}
+
+SessionRecorder::SessionRecorder(QIODevice *device) :
+    m_device(device), m_base_msecs(0), m_last_msecs(0), m_last_pos(0, 0)
+{
+}
+
+void SessionRecorder::begin(const BoardMap &map, bool prevent_mistakes)
+{
+    QByteArray header(MAGIC, MAGIC_SIZE);
+    header.append(VERSION);
+    appendVarint(header, map.width());
+    appendVarint(header, map.height());
+    header.append((char)(prevent_mistakes ? FLAG_PREVENT_MISTAKES : 0));
+
+    const quint64 h = hash(map);
+    for (int i = 0; i < 8; i++) {
+        header.append((char)((h >> (8 * i)) & 0xff));
+    }
+
+    QByteArray bits((map.width() * map.height() + 7) / 8, 0);
+    char *data = bits.data();
+    for (int y = 0; y < map.height(); y++) {
+        for (int x = 0; x < map.width(); x++) {
+            if (map.get(x, y) == Board::Box) {
+                const int i = y * map.width() + x;
+                data[i / 8] |= (char)(1 << (i % 8));
+            }
+        }
+    }
+    header.append(bits);
+
+    m_device->write(header);
+
+    m_timer.start();
+    m_base_msecs = 0;
+    m_last_msecs = 0;
+    m_last_pos = QPoint(0, 0);
+}
+
+void SessionRecorder::resume(qint64 last_msecs, const QPoint &last_pos)
+{
+    m_timer.start();
+    m_base_msecs = last_msecs;
+    m_last_msecs = last_msecs;
+    m_last_pos = last_pos;
+}
+
+void SessionRecorder::record(SessionEvent::Type type, const QPoint &pos,
+                             Board::State state)
+{
+    const qint64 msecs = m_base_msecs + m_timer.elapsed();
+
+    QByteArray event;
+    event.append((char)((type & TYPE_MASK) | ((state & STATE_MASK) << STATE_SHIFT)));
+    appendVarint(event, msecs - m_last_msecs);
+    m_last_msecs = msecs;
+
+    if (type == SessionEvent::SetState || type == SessionEvent::Hint) {
+        appendVarint(event, zigzag(pos.x() - m_last_pos.x()));
+        appendVarint(event, zigzag(pos.y() - m_last_pos.y()));
+        m_last_pos = pos;
+    }
+
+    m_device->write(event);
+}
+
+SessionReader::SessionReader(const QByteArray &data) :
+    m_data(data), m_offset(0), m_header_size(0), m_valid(false), m_prevent_mistakes(false),
+    m_hash(0), m_last_msecs(0), m_last_pos(0, 0)
+{
+    m_valid = readHeader();
+}
+
+bool SessionReader::readVarint(quint64 *value)
+{
+    quint64 result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (m_offset >= m_data.size()) {
+            return false;
+        }
+        const uchar byte = (uchar)m_data[m_offset++];
+        result |= (quint64)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SessionReader::readHeader()
+{
+    if (m_data.size() < MAGIC_SIZE + 1 || !m_data.startsWith(QByteArray(MAGIC, MAGIC_SIZE))) {
+        return false;
+    }
+    m_offset = MAGIC_SIZE;
+
+    if (m_data[m_offset++] != VERSION) {
+        return false;
+    }
+
+    /* Bound each dimension first, their product must not wrap around. */
+    quint64 width, height;
+    if (!readVarint(&width) || !readVarint(&height)
+            || width == 0 || height == 0 || width > INT_MAX || height > INT_MAX
+            || width * height > INT_MAX) {
+        return false;
+    }
+
+    const int bytes = (width * height + 7) / 8;
+    if (m_offset + 1 + 8 + bytes > m_data.size()) {
+        return false;
+    }
+
+    m_prevent_mistakes = (m_data[m_offset++] & FLAG_PREVENT_MISTAKES);
+
+    m_hash = 0;
+    for (int i = 0; i < 8; i++) {
+        m_hash |= (quint64)(uchar)m_data[m_offset++] << (8 * i);
+    }
+
+    QList<Board::State> states;
+    states.reserve(width * height);
+    for (int i = 0; i < (int)(width * height); i++) {
+        const bool box = ((uchar)m_data[m_offset + i / 8] >> (i % 8)) & 1;
+        states.append(box ? Board::Box : Board::Nothing);
+    }
+    m_offset += bytes;
+    m_header_size = m_offset;
+
+    m_map = QSharedPointer<BoardMap>(new BoardMap(width, height, states));
+
+    return (SessionRecorder::hash(*m_map) == m_hash);
+}
+
+bool SessionReader::readEvent(SessionEvent *event)
+{
+    if (!m_valid || m_offset >= m_data.size()) {
+        return false;
+    }
+
+    /* On failure, leave the offset at the end of the last complete event. */
+    const int start = m_offset;
+
+    const uchar tag = (uchar)m_data[m_offset++];
+    const int type = tag & TYPE_MASK;
+
+    quint64 delta, dx = 0, dy = 0;
+    const bool has_pos = (type == SessionEvent::SetState || type == SessionEvent::Hint);
+    if (type > SessionEvent::LoadState || !readVarint(&delta)
+            || (has_pos && (!readVarint(&dx) || !readVarint(&dy)))) {
+        m_offset = start;
+        return false;
+    }
+
+    const QPoint pos = m_last_pos + QPoint(unzigzag(dx), unzigzag(dy));
+    if (has_pos && m_map->outOfBounds(pos.x(), pos.y())) {
+        m_offset = start;
+        return false;
+    }
+
+    /* Players can only mark boxes and crosses. */
+    const Board::State state = (Board::State)((tag >> STATE_SHIFT) & STATE_MASK);
+    if (type == SessionEvent::SetState && state != Board::Box && state != Board::Cross) {
+        m_offset = start;
+        return false;
+    }
+
+    event->type = (SessionEvent::Type)type;
+    event->state = state;
+    event->msecs = m_last_msecs + delta;
+    event->pos = has_pos ? pos : QPoint();
+
+    m_last_msecs = event->msecs;
+    if (has_pos) {
+        m_last_pos = pos;
+    }
+
+    return true;
+}
+
+bool SessionReader::seek(int offset, qint64 last_msecs, const QPoint &last_pos)
+{
+    if (!m_valid || offset < m_header_size || offset > m_data.size()) {
+        return false;
+    }
+
+    m_offset = offset;
+    m_last_msecs = last_msecs;
+    m_last_pos = last_pos;
+
+    return true;
+}
+
+SessionPlayer::SessionPlayer(const QByteArray &log, QObject *parent) :
+    QObject(parent), m_reader(log), m_has_next(false), m_won(false),
+    m_elapsed_msecs(0)
+{
+    if (!m_reader.isValid()) {
+        return;
+    }
+
+    m_game = QSharedPointer<Picmi>(new Picmi(m_reader.map(), m_reader.preventMistakes()));
+    connect(m_game.data(), SIGNAL(gameWon()), this, SLOT(gameWon()));
+
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &SessionPlayer::playNext);
+
+    m_has_next = m_reader.readEvent(&m_next);
+}
+
+void SessionPlayer::apply(Picmi *game, SessionEvent &event)
+{
+    switch (event.type) {
+    case SessionEvent::SetState: game->setState(event.pos.x(), event.pos.y(), event.state); break;
+    case SessionEvent::Undo: event.pos = game->undo(); break;
+    case SessionEvent::Hint: game->hintAt(event.pos); break;
+    case SessionEvent::SaveState: game->saveState(); break;
+    case SessionEvent::LoadState: game->loadState(); break;
+    default: break;
+    }
+}
+
+bool SessionPlayer::step(SessionEvent *event)
+{
+    if (!m_has_next) {
+        return false;
+    }
+
+    SessionEvent current = m_next;
+    m_has_next = m_reader.readEvent(&m_next);
+
+    apply(m_game.data(), current);
+    m_elapsed_msecs = current.msecs;
+    if (event) {
+        *event = current;
+    }
+
+    return true;
+}
+
+void SessionPlayer::playAll()
+{
+    while (step()) {
+        /* Nothing. */
+    }
+}
+
+void SessionPlayer::start()
+{
+    scheduleNext();
+}
+
+void SessionPlayer::scheduleNext()
+{
+    if (!m_has_next) {
+        emit finished();
+        return;
+    }
+
+    m_timer.start((int)qMax((qint64)0, m_next.msecs - m_elapsed_msecs));
+}
+
+void SessionPlayer::playNext()
+{
+    (void)step();
+    scheduleNext();
+}
+
+void SessionPlayer::gameWon()
+{
+    m_won = true;
+}
@@ -0,0 +1,197 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPoint>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include "board.h"
+
+class BoardMap;
+class Picmi;
+class QIODevice;
+
+/* A session log is a compact binary record of a single game. It consists of
+   a header followed by a sequence of events:
+
+     header: "PMSL", version byte, width and height (varints), flags byte,
+             64 bit map hash (PackedMap::hash()), and the map itself (one
+             bit per cell, LSB first)
+     event:  type and state byte, milliseconds since the previous event
+             (varint), and for SetState and Hint events the coordinate delta
+             to the previous coordinate (zigzag varints).
+
+   Since the log contains the full map, replaying a session is entirely
+   deterministic. */
+
+struct SessionEvent
+{
+    enum Type {
+        SetState,
+        Undo,
+        Hint,
+        SaveState,
+        LoadState
+    };
+
+    Type type;
+    qint64 msecs;   /**< Milliseconds since the start of the session. */
+    QPoint pos;     /**< Only valid for SetState and Hint. Events returned by
+                         SessionPlayer::step() also carry the coordinate
+                         changed by an Undo. */
+    Board::State state; /**< Only valid for SetState. */
+};
+
+class SessionRecorder
+{
+public:
+    /* device must be open for writing and outlive the recorder */
+    explicit SessionRecorder(QIODevice *device);
+
+    /* writes the log header. called by Picmi::setRecorder() */
+    void begin(const BoardMap &map, bool prevent_mistakes);
+
+    /* continues an existing log on the device instead of writing a new
+       header. last_msecs and last_pos are the state of the log's last
+       event as returned by SessionReader */
+    void resume(qint64 last_msecs, const QPoint &last_pos);
+
+    bool isStarted() const { return m_timer.isValid(); }
+
+    qint64 lastMsecs() const { return m_last_msecs; }
+    QPoint lastPos() const { return m_last_pos; }
+
+    /* appends a single event, timestamped with the current time */
+    void record(SessionEvent::Type type, const QPoint &pos = QPoint(),
+                Board::State state = Board::Nothing);
+
+    /* returns a hash identifying the contents of the given map */
+    static quint64 hash(const BoardMap &map);
+
+private:
+    QIODevice *m_device;
+    QElapsedTimer m_timer;
+    qint64 m_base_msecs;
+    qint64 m_last_msecs;
+    QPoint m_last_pos;
+};
+
+class SessionReader
+{
+public:
+    explicit SessionReader(const QByteArray &data);
+
+    /* returns false if the header could not be parsed or the
+       map does not match its hash */
+    bool isValid() const { return m_valid; }
+
+    QSharedPointer<BoardMap> map() const { return m_map; }
+    bool preventMistakes() const { return m_prevent_mistakes; }
+    quint64 mapHash() const { return m_hash; }
+
+    /* reads the next event into event. returns false once the end of the
+       log is reached or if the log is truncated */
+    bool readEvent(SessionEvent *event);
+
+    /* continues reading events at the given byte offset, which must be
+       the end of an event previously returned together with last_msecs
+       and last_pos */
+    bool seek(int offset, qint64 last_msecs, const QPoint &last_pos);
+
+    /* returns the byte offset just past the last complete event read */
+    int offset() const { return m_offset; }
+    /* returns the size of the header, which is the offset of the first event */
+    int headerSize() const { return m_header_size; }
+    qint64 lastMsecs() const { return m_last_msecs; }
+    QPoint lastPos() const { return m_last_pos; }
+
+private:
+    bool readVarint(quint64 *value);
+    bool readHeader();
+
+    const QByteArray m_data;
+    int m_offset;
+    int m_header_size;
+    bool m_valid;
+
+    QSharedPointer<BoardMap> m_map;
+    bool m_prevent_mistakes;
+    quint64 m_hash;
+
+    qint64 m_last_msecs;
+    QPoint m_last_pos;
+};
+
+/* Drives a Picmi instance from a session log, either at full speed
+   or in real time using the recorded timestamps. */
+class SessionPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionPlayer(const QByteArray &log, QObject *parent = 0);
+
+    bool isValid() const { return !m_game.isNull(); }
+    QSharedPointer<Picmi> game() const { return m_game; }
+
+    /* applies the next event to the game and optionally returns it in event.
+       returns false if no events are left */
+    bool step(SessionEvent *event = 0);
+
+    /* plays back all remaining events at full speed */
+    void playAll();
+
+    /* plays back all remaining events in real time, emits finished() when done */
+    void start();
+
+    /* applies a single event to game. for Undo events, event.pos is set
+       to the changed coordinate */
+    static void apply(Picmi *game, SessionEvent &event);
+
+    /* returns true if the game has been won during playback */
+    bool won() const { return m_won; }
+
+    /* returns the timestamp of the last event that has been played */
+    qint64 elapsedMsecs() const { return m_elapsed_msecs; }
+
+signals:
+    void finished();
+
+private slots:
+    void gameWon();
+    void playNext();
+
+private:
+    void scheduleNext();
+
+    SessionReader m_reader;
+    QSharedPointer<Picmi> m_game;
+    QTimer m_timer;
+
+    SessionEvent m_next;
+    bool m_has_next;
+
+    bool m_won;
+    qint64 m_elapsed_msecs;
+};
+
+#endif // SESSIONLOG_H
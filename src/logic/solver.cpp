@@ -0,0 +1,232 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "solver.h"
+
+Solver::Solver(const QVector<QVector<int> > &rows, const QVector<QVector<int> > &cols)
+    : m_rows(rows), m_cols(cols), m_solutions(0), m_guesses(0), m_aborted(false)
+{
+}
+
+Solver::Result Solver::solve(int max_guesses) {
+    m_solution = PackedMap();
+    m_solutions = 0;
+    m_guesses = 0;
+    m_aborted = false;
+
+    if (width() == 0 || height() == 0) {
+        return Contradiction;
+    }
+
+    search(QVector<char>(width() * height(), Unknown),
+           QVector<bool>(width() + height(), true), max_guesses);
+
+    if (m_solutions > 1) {
+        return Multiple;
+    } else if (m_aborted) {
+        return Aborted;
+    } else if (m_solutions == 1) {
+        return Unique;
+    }
+    return Contradiction;
+}
+
+void Solver::search(QVector<char> cells, QVector<bool> dirty, int max_guesses) {
+    /* Solutions are counted up to two, which is enough to tell whether the
+       first one is unique. */
+
+    if (m_solutions > 1 || m_aborted || !propagate(cells, dirty)) {
+        return;
+    }
+
+    const int unknown = cells.indexOf(Unknown);
+    if (unknown < 0) {
+        if (m_solutions++ == 0) {
+            m_solution = PackedMap(width(), height());
+            for (int i = 0; i < cells.size(); i++) {
+                if (cells[i] == Box) {
+                    m_solution.set(i % width(), i / width(), Board::Box);
+                }
+            }
+        }
+        return;
+    }
+
+    if (m_guesses >= max_guesses) {
+        m_aborted = true;
+        return;
+    }
+    m_guesses++;
+
+    const int x = unknown % width();
+    const int y = unknown / width();
+    dirty[y] = true;
+    dirty[height() + x] = true;
+
+    cells[unknown] = Box;
+    search(cells, dirty, max_guesses);
+    cells[unknown] = Empty;
+    search(cells, dirty, max_guesses);
+}
+
+bool Solver::propagate(QVector<char> &cells, QVector<bool> &dirty) const {
+    /* dirty holds the rows followed by the columns. A line is solved again
+       whenever a crossing line has changed one of its cells. */
+
+    QVector<char> line, before;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (int l = 0; l < dirty.size(); l++) {
+            if (!dirty[l]) {
+                continue;
+            }
+            dirty[l] = false;
+
+            const bool is_row = (l < height());
+            const int index = is_row ? l : l - height();
+            const int length = is_row ? width() : height();
+            const int step = is_row ? 1 : width();
+            const int first = is_row ? index * width() : index;
+
+            line.resize(length);
+            for (int i = 0; i < length; i++) {
+                line[i] = cells[first + i * step];
+            }
+            before = line;
+
+            if (!solveLine(is_row ? m_rows[index] : m_cols[index], line)) {
+                return false;
+            }
+
+            for (int i = 0; i < length; i++) {
+                if (line[i] == before[i]) {
+                    continue;
+                }
+                cells[first + i * step] = line[i];
+                dirty[is_row ? height() + i : i] = true;
+                changed = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Solver::solveLine(const QVector<int> &clues, QVector<char> &line) {
+    /* fwd[j][i] is set if cells [0, i) can hold exactly the first j blocks,
+     * bwd[j][i] if cells [i, n) can hold exactly blocks j to k - 1. A cell
+     * may be empty if a split around it works on both sides, and may be a
+     * box if a placement of some block covering it does. Both tables take
+     * O(n * k) time. */
+
+    const int n = line.size();
+    const int k = clues.size();
+    const int columns = n + 1;
+
+    /* empties[i] is the count of Empty cells in [0, i). */
+    QVector<int> empties(n + 1, 0);
+    for (int i = 0; i < n; i++) {
+        empties[i + 1] = empties[i] + (line[i] == Empty);
+    }
+
+#define CAN_BOX(begin, end) (empties[(end)] == empties[(begin)])
+#define CAN_EMPTY(i) (line[(i)] != Box)
+
+    QVector<char> fwd((k + 1) * columns, 0);
+    fwd[0] = 1;
+    for (int i = 1; i <= n; i++) {
+        for (int j = 0; j <= k; j++) {
+            bool v = fwd[j * columns + i - 1] && CAN_EMPTY(i - 1);
+            if (!v && j > 0) {
+                const int begin = i - clues[j - 1];
+                if (begin >= 0 && CAN_BOX(begin, i)) {
+                    v = (begin == 0) ? (j == 1)
+                                     : CAN_EMPTY(begin - 1) && fwd[(j - 1) * columns + begin - 1];
+                }
+            }
+            fwd[j * columns + i] = v;
+        }
+    }
+
+    if (!fwd[k * columns + n]) {
+        return false;
+    }
+
+    QVector<char> bwd((k + 1) * columns, 0);
+    bwd[k * columns + n] = 1;
+    for (int i = n - 1; i >= 0; i--) {
+        for (int j = k; j >= 0; j--) {
+            bool v = bwd[j * columns + i + 1] && CAN_EMPTY(i);
+            if (!v && j < k) {
+                const int end = i + clues[j];
+                if (end <= n && CAN_BOX(i, end)) {
+                    v = (end == n) ? (j == k - 1)
+                                   : CAN_EMPTY(end) && bwd[(j + 1) * columns + end + 1];
+                }
+            }
+            bwd[j * columns + i] = v;
+        }
+    }
+
+    /* boxes[i] accumulates the number of valid block placements starting
+       at or before i minus those ending at or before i. */
+    QVector<int> boxes(n + 1, 0);
+    for (int j = 0; j < k; j++) {
+        for (int begin = 0, end = clues[j]; end <= n; begin++, end++) {
+            if (!CAN_BOX(begin, end)) {
+                continue;
+            }
+            const bool left = (begin == 0) ? (j == 0)
+                                           : CAN_EMPTY(begin - 1) && fwd[j * columns + begin - 1];
+            const bool right = (end == n) ? (j == k - 1)
+                                          : CAN_EMPTY(end) && bwd[(j + 1) * columns + end + 1];
+            if (left && right) {
+                boxes[begin]++;
+                boxes[end]--;
+            }
+        }
+    }
+
+    int covering = 0;
+    for (int i = 0; i < n; i++) {
+        covering += boxes[i];
+
+        bool can_empty = false;
+        if (CAN_EMPTY(i)) {
+            for (int j = 0; j <= k && !can_empty; j++) {
+                can_empty = fwd[j * columns + i] && bwd[j * columns + i + 1];
+            }
+        }
+        const bool can_box = (covering > 0);
+
+        if (!can_box && !can_empty) {
+            return false;
+        } else if (!can_empty) {
+            line[i] = Box;
+        } else if (!can_box) {
+            line[i] = Empty;
+        }
+    }
+
+#undef CAN_BOX
+#undef CAN_EMPTY
+
+    return true;
+}
@@ -0,0 +1,81 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <QVector>
+
+#include "src/logic/packedmap.h"
+
+/* Finds maps matching a set of row and column clues. Lines are solved
+   exactly, one at a time, until no further cells can be deduced. If cells
+   remain unknown, the solver guesses and backtracks. */
+class Solver
+{
+public:
+    enum Result {
+        Unique,         /* exactly one map matches the clues */
+        Multiple,       /* several maps match, solution() is one of them */
+        Contradiction,  /* no map matches */
+        Aborted         /* the guess limit was reached */
+    };
+
+    /* rows.size() is the height, cols.size() the width of the map. a line
+       without boxes has no clues */
+    Solver(const QVector<QVector<int> > &rows, const QVector<QVector<int> > &cols);
+
+    /* solves the puzzle, guessing at most max_guesses times */
+    Result solve(int max_guesses = 1000);
+
+    /* returns the solution found by solve(), or a null map */
+    PackedMap solution() const { return m_solution; }
+
+    /* returns the number of guesses made by solve(). 0 means the puzzle is
+       solvable by line solving alone */
+    int guesses() const { return m_guesses; }
+
+private:
+    enum Cell {
+        Unknown,
+        Box,
+        Empty
+    };
+
+    /* propagates cells until a fixpoint is reached. returns false on a
+       contradiction */
+    bool propagate(QVector<char> &cells, QVector<bool> &dirty) const;
+
+    /* deduces what can be known about line given its current cells.
+       returns false if no arrangement of the clues fits */
+    static bool solveLine(const QVector<int> &clues, QVector<char> &line);
+
+    /* searches for up to two solutions starting at cells */
+    void search(QVector<char> cells, QVector<bool> dirty, int max_guesses);
+
+    int width() const { return m_cols.size(); }
+    int height() const { return m_rows.size(); }
+
+    const QVector<QVector<int> > m_rows, m_cols;
+
+    PackedMap m_solution;
+    int m_solutions;
+    int m_guesses;
+    bool m_aborted;
+};
+
+#endif // SOLVER_H
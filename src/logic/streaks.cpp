@@ -102,17 +102,24 @@ Streaks::lineToStreaks(const QVector<Board::State> &line,
 }
 
 QVector<Streaks::Streak>
-Streaks::processStreak(const QVector<StreakPrivate> &map,
+Streaks::initialStreak(const QVector<int> &map)
+{
+    QVector<Streaks::Streak> streak(map.size());
+    for (int i = 0; i < map.size(); i++) {
+        streak[i].value = map[i];
+    }
+    return streak;
+}
+
+QVector<Streaks::Streak>
+Streaks::processStreak(const QVector<int> &map,
                        const QVector<Board::State> &l)
 {        
-    QVector<Streaks::Streak> streak;
     QVector<StreakPrivate *> assocs(map.size(), NULL);
 
     /* Initial values for returned streaks. */
 
-    for (int i = 0; i < map.size(); i++) {
-        streak.push_back(map[i]);
-    }
+    QVector<Streaks::Streak> streak = initialStreak(map);
 
     /* Create the state streaks. */
 
@@ -166,33 +173,36 @@ Streaks::processStreak(const QVector<StreakPrivate> &map,
 Streaks::Streaks(QSharedPointer<BoardMap> map, QSharedPointer<BoardState> state)
     : m_map(map), m_state(state)
 {
+    if (m_state->undoStackSize() > 0 || m_state->boxCount() > 0) {
+        update();
+        return;
+    }
+
+    m_state_col_streaks.reserve(m_map->width());
     for (int x = 0; x < m_map->width(); x++) {
-        QVector<Board::State> line = colToLine(m_map, x);
-        m_map_col_streaks.push_back(lineToStreaks(line, Board::Nothing));
+        m_state_col_streaks.push_back(initialStreak(m_map->colClues(x)));
     }
 
+    m_state_row_streaks.reserve(m_map->height());
     for (int y = 0; y < m_map->height(); y++) {
-        QVector<Board::State> line = rowToLine(m_map, y);
-        m_map_row_streaks.push_back(lineToStreaks(line, Board::Nothing));
+        m_state_row_streaks.push_back(initialStreak(m_map->rowClues(y)));
     }
-
-    update();
 }
 
 void Streaks::update(int x, int y) {
-    m_state_col_streaks[x] = processStreak(m_map_col_streaks[x], colToLine(m_state, x));
-    m_state_row_streaks[y] = processStreak(m_map_row_streaks[y], rowToLine(m_state, y));
+    m_state_col_streaks[x] = processStreak(m_map->colClues(x), colToLine(m_state, x));
+    m_state_row_streaks[y] = processStreak(m_map->rowClues(y), rowToLine(m_state, y));
 }
 
 void Streaks::update() {
     m_state_col_streaks.clear();
     for (int x = 0; x < m_state->width(); x++) {
-        m_state_col_streaks.push_back(processStreak(m_map_col_streaks[x], colToLine(m_state, x)));
+        m_state_col_streaks.push_back(processStreak(m_map->colClues(x), colToLine(m_state, x)));
     }
 
     m_state_row_streaks.clear();
     for (int y = 0; y < m_state->height(); y++) {
-        m_state_row_streaks.push_back(processStreak(m_map_row_streaks[y], rowToLine(m_state, y)));
+        m_state_row_streaks.push_back(processStreak(m_map->rowClues(y), rowToLine(m_state, y)));
     }
 }
 
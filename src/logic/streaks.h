@@ -33,6 +33,8 @@ public:
         bool solved;
     };
 
+    /* Map streaks are taken from the clues of map. If state has not been
+       modified yet, no line is scanned since all streaks are unsolved. */
     Streaks(QSharedPointer<BoardMap> map, QSharedPointer<BoardState> state);
 
     /* Updates streaks affected by changes to (x,y). */
@@ -58,21 +60,20 @@ private: /* Functions. */
     static QVector<StreakPrivate> lineToStreaks(const QVector<Board::State> &line,
                                                 Board::State filler);
 
-    /** Given a map streak sequence as well as the current state of the associated line,
+    /** Given the clues of a line as well as its current state,
      *  processStreak() returns the state streaks. */
-    static QVector<Streak> processStreak(const QVector<StreakPrivate> &map,
+    static QVector<Streak> processStreak(const QVector<int> &map,
                                          const QVector<Board::State> &l);
 
+    /** Returns the state streaks of a line none of whose cells has been set. */
+    static QVector<Streak> initialStreak(const QVector<int> &map);
+
 private: /* Variables. */
     QSharedPointer<BoardMap> m_map;
     QSharedPointer<BoardState> m_state;
 
-    /** Map streaks are calculated once upon construction and then stay immutable
-     *  for the remaining lifetime of a Streaks object. They store information about
-     *  the actual map streaks, including the streak beginning index, end index, and
-     *  length. */
-    QVector<QVector<StreakPrivate> > m_map_row_streaks;
-    QVector<QVector<StreakPrivate> > m_map_col_streaks;
+    /* Map streaks are the row and column clues of m_map, which are computed once
+     * per BoardMap and shared by all games played on it. */
 
     /** State streaks are recomputed whenever the state of an associated cell changes.
      *  Unlike the map streaks, row streaks only store the publicly available information:
@@ -0,0 +1,154 @@
+/* *************************************************************************
+ *  Copyright 2015 Jakob Gruber <jakob.gruber@gmail.com>                   *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 2 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+
+/* Converts XML levelsets, puzzle files and images into a single level pack
+   (see levelpack.h), which is gzip compressed if its name ends in .gz. */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <QtConcurrentMap>
+
+#include "src/logic/imageimporter.h"
+#include "src/logic/levelloader.h"
+#include "src/logic/levelpack.h"
+
+/* Imports a single image as a level, suitable for QtConcurrent. */
+class ImageLevelLoader
+{
+public:
+    typedef QSharedPointer<Level> result_type;
+
+    ImageLevelLoader(const ImageImporter &importer, const QString &levelset,
+                     const QString &author)
+        : m_importer(importer), m_levelset(levelset), m_author(author) { }
+
+    result_type operator()(const QString &path) const {
+        return m_importer.loadLevel(path, m_levelset, m_author);
+    }
+
+private:
+    const ImageImporter m_importer;
+    const QString m_levelset, m_author;
+};
+
+/* removes the option "name=value" from args and returns its value, or
+   fallback if it is not present */
+static QString takeOption(QStringList *args, const QString &name, const QString &fallback) {
+    const QString prefix = name + "=";
+    for (int i = 0; i < args->size(); i++) {
+        if (args->at(i).startsWith(prefix)) {
+            return args->takeAt(i).mid(prefix.size());
+        }
+    }
+    return fallback;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    QStringList args = app.arguments();
+    const QString program = args.takeFirst();
+
+    /* --dedup removes duplicate levels, --dedup-symmetric additionally
+       removes rotated and mirrored copies. */
+
+    const bool dedup = args.contains("--dedup") || args.contains("--dedup-symmetric");
+    const bool symmetric = args.contains("--dedup-symmetric");
+    args.removeAll("--dedup");
+    args.removeAll("--dedup-symmetric");
+
+    /* Images and directories of images are imported into a single
+       levelset. Greyscale images are thresholded, or dithered with
+       --dither. */
+
+    ImageImporter importer;
+    if (args.removeAll("--dither") > 0) {
+        importer.setMode(ImageImporter::Dither);
+    }
+    importer.setThreshold(takeOption(&args, "--threshold", "128").toInt());
+
+    QString levelset = takeOption(&args, "--levelset", QString());
+    const QString author = takeOption(&args, "--author", "Unknown");
+
+    if (args.size() < 2 || !LevelPack::isPack(args[0])
+            || importer.threshold() <= 0 || importer.threshold() >= 256) {
+        err << "Usage: " << program << " [--dedup|--dedup-symmetric] [--dither]"
+            << " [--threshold=<1-255>] [--levelset=<name>] [--author=<name>] <output"
+            << LevelPack::SUFFIX << "[" << LevelLoader::COMPRESSED_SUFFIX << "]>"
+            << " <levelset.xml[.gz]|puzzle|image|directory>...\n";
+        return 1;
+    }
+
+    if (levelset.isEmpty()) {
+        levelset = QFileInfo(args[0]).baseName();
+    }
+
+    QList<QSharedPointer<Level> > levels;
+    QStringList images;
+    for (int i = 1; i < args.size(); i++) {
+        if (QFileInfo(args[i]).isDir()) {
+            const QDir dir(args[i]);
+            foreach (const QString &name, dir.entryList(ImageImporter::nameFilters(),
+                                                        QDir::Files, QDir::Name)) {
+                images.append(dir.filePath(name));
+            }
+            continue;
+        } else if (ImageImporter::isImage(args[i])) {
+            images.append(args[i]);
+            continue;
+        }
+
+        const QList<QSharedPointer<Level> > l = LevelLoader::loadLevelset(args[i]);
+        err << args[i] << ": " << l.size() << " levels\n";
+        levels.append(l);
+    }
+
+    if (!images.isEmpty()) {
+        const QList<QSharedPointer<Level> > l =
+                QtConcurrent::blockingMapped<QList<QSharedPointer<Level> > >(
+                    images, ImageLevelLoader(importer, levelset, author));
+
+        int imported = 0;
+        foreach (const QSharedPointer<Level> &level, l) {
+            if (level) {
+                levels.append(level);
+                imported++;
+            }
+        }
+        err << imported << " of " << images.size() << " images imported\n";
+    }
+
+    if (dedup) {
+        const int count = levels.size();
+        levels = LevelLoader::deduplicate(levels, symmetric);
+        err << count - levels.size() << " duplicates removed\n";
+    }
+
+    if (!LevelPack::write(args[0], levels)) {
+        err << "Can't write " << args[0] << "\n";
+        return 1;
+    }
+
+    err << args[0] << ": " << levels.size() << " levels written\n";
+    return 0;
+}
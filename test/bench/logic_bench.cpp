@@ -0,0 +1,197 @@
+#include "logic_bench.h"
+
+#include <QTest>
+
+#include "picmi.h"
+
+QTEST_GUILESS_MAIN(LogicBench)
+
+void LogicBench::boardSizes()
+{
+    static const int sizes[] = { 5, 10, 25, 100, 1000 };
+    static const double densities[] = { 0.2, 0.55, 0.8 };
+
+    QTest::addColumn<int>("size");
+    QTest::addColumn<double>("density");
+
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (unsigned int j = 0; j < sizeof(densities) / sizeof(densities[0]); j++) {
+            const QString name = QString("%1x%1@%2").arg(sizes[i]).arg(densities[j]);
+            QTest::newRow(name.toLatin1().constData()) << sizes[i] << densities[j];
+        }
+    }
+}
+
+/**
+ * Marks roughly half of the correct cells of the map in the state,
+ * such that streak computations operate on a partially solved board.
+ */
+static void halfSolve(const QSharedPointer<BoardMap> &map,
+                      const QSharedPointer<BoardState> &state)
+{
+    for (int y = 0; y < map->height(); y++) {
+        for (int x = (y % 2); x < map->width(); x += 2) {
+            state->set(x, y, (map->get(x, y) == Board::Box) ? Board::Box : Board::Cross);
+        }
+    }
+}
+
+void LogicBench::benchBoardMap_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchBoardMap()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QBENCHMARK {
+        BoardMap map(size, size, density);
+        Q_UNUSED(map);
+    }
+}
+
+void LogicBench::benchStreaksConstruction_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchStreaksConstruction()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QSharedPointer<BoardMap> map(new BoardMap(size, size, density));
+    QSharedPointer<BoardState> state(new BoardState(size, size));
+
+    QBENCHMARK {
+        Streaks streaks(map, state);
+        Q_UNUSED(streaks);
+    }
+}
+
+void LogicBench::benchStreaksUpdateCell_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchStreaksUpdateCell()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QSharedPointer<BoardMap> map(new BoardMap(size, size, density));
+    QSharedPointer<BoardState> state(new BoardState(size, size));
+    halfSolve(map, state);
+    Streaks streaks(map, state);
+
+    int i = 0;
+    QBENCHMARK {
+        streaks.update(i % size, (i / size) % size);
+        i++;
+    }
+}
+
+void LogicBench::benchStreaksUpdate_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchStreaksUpdate()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QSharedPointer<BoardMap> map(new BoardMap(size, size, density));
+    QSharedPointer<BoardState> state(new BoardState(size, size));
+    halfSolve(map, state);
+    Streaks streaks(map, state);
+
+    QBENCHMARK {
+        streaks.update();
+    }
+}
+
+void LogicBench::benchSetState_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchSetState()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QSharedPointer<BoardMap> map(new BoardMap(size, size, density));
+    Picmi game(map);
+
+    /* Toggles boxes on and off, walking across the entire board. */
+    int i = 0;
+    QBENCHMARK {
+        game.setState(i % size, (i / size) % size, Board::Box);
+        i++;
+    }
+}
+
+void LogicBench::benchHint_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchHint()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QSharedPointer<BoardMap> map(new BoardMap(size, size, density));
+    Picmi game(map);
+
+    /* On an empty board, each hint results in exactly one undoable action. */
+    QBENCHMARK {
+        game.hint();
+        game.undo();
+    }
+}
+
+void LogicBench::benchUndo_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchUndo()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QSharedPointer<BoardMap> map(new BoardMap(size, size, density));
+    Picmi game(map);
+
+    QBENCHMARK {
+        game.setState(0, 0, Board::Cross);
+        game.undo();
+    }
+}
+
+void LogicBench::benchLoadState_data()
+{
+    boardSizes();
+}
+
+void LogicBench::benchLoadState()
+{
+    QFETCH(int, size);
+    QFETCH(double, density);
+
+    QSharedPointer<BoardMap> map(new BoardMap(size, size, density));
+    Picmi game(map);
+
+    /* Rewinds a full row of actions per iteration. */
+    QBENCHMARK {
+        game.saveState();
+        for (int x = 0; x < size; x++) {
+            game.setState(x, 0, Board::Cross);
+        }
+        game.loadState();
+    }
+}
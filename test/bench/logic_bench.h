@@ -0,0 +1,37 @@
+#ifndef __LOGIC_BENCH_H
+#define __LOGIC_BENCH_H
+
+#include <QObject>
+
+/**
+ * Micro-benchmarks for the hot paths of the game logic. Each benchmark
+ * is parameterized over square boards from 5x5 up to 1000x1000 and
+ * several box densities through the shared boardSizes() data table.
+ */
+class LogicBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void benchBoardMap_data();
+    void benchBoardMap();
+    void benchStreaksConstruction_data();
+    void benchStreaksConstruction();
+    void benchStreaksUpdateCell_data();
+    void benchStreaksUpdateCell();
+    void benchStreaksUpdate_data();
+    void benchStreaksUpdate();
+    void benchSetState_data();
+    void benchSetState();
+    void benchHint_data();
+    void benchHint();
+    void benchUndo_data();
+    void benchUndo();
+    void benchLoadState_data();
+    void benchLoadState();
+
+private:
+    void boardSizes();
+};
+
+#endif /* __LOGIC_BENCH_H */
@@ -0,0 +1,244 @@
+/*
+ * Replays a corpus of recorded game sessions (see src/logic/sessionlog.h)
+ * and reports throughput, per-event latency percentiles and allocation
+ * counts, both for the bare game logic and with a Scene attached to the
+ * game as in the real application.
+ *
+ * Usage: replay_bench [log files or directories containing *.pmsl logs]
+ *
+ * If no corpus is given, a synthetic one is generated by recording random
+ * play on boards of various sizes. The results are printed as CSV.
+ */
+
+#include <QApplication>
+#include <QBuffer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <QtAlgorithms>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "src/gui/renderer.h"
+#include "src/gui/scene.h"
+#include "src/logic/picmi.h"
+#include "src/logic/sessionlog.h"
+
+/* Count all heap allocations made by the process. */
+
+static std::atomic<quint64> g_allocations(0);
+
+void *operator new(std::size_t size)
+{
+    g_allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+struct Result {
+    Result() : sessions(0), nsecs(0), allocations(0) { }
+
+    int sessions;
+    qint64 nsecs;
+    quint64 allocations;
+    QVector<qint64> latencies;
+};
+
+static QList<QByteArray> loadCorpus(const QStringList &paths)
+{
+    QList<QByteArray> corpus;
+
+    foreach (const QString &path, paths) {
+        QStringList files;
+        if (QFileInfo(path).isDir()) {
+            QDir dir(path);
+            foreach (const QString &file, dir.entryList(QStringList("*.pmsl"), QDir::Files)) {
+                files << dir.absoluteFilePath(file);
+            }
+        } else {
+            files << path;
+        }
+
+        foreach (const QString &file, files) {
+            QFile f(file);
+            if (f.open(QIODevice::ReadOnly)) {
+                corpus << f.readAll();
+            }
+        }
+    }
+
+    return corpus;
+}
+
+/* Records random play which roughly resembles a human player: mostly boxes
+   and crosses near the previous position, with occasional undos, hints
+   and saved positions. */
+static QByteArray recordSession(int width, int height)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    Picmi game(width, height, 0.55, false);
+    game.setRecorder(QSharedPointer<SessionRecorder>(new SessionRecorder(&buffer)));
+
+    QPoint p(0, 0);
+    for (int i = 0; i < 2 * width * height; i++) {
+        const int r = qrand() % 100;
+        if (r < 5) {
+            game.undo();
+        } else if (r < 6) {
+            game.hint();
+        } else if (r < 8) {
+            game.saveState();
+        } else if (r < 9) {
+            game.loadState();
+        } else {
+            p = QPoint((p.x() + qrand() % 3 + width - 1) % width,
+                       (p.y() + qrand() % 3 + height - 1) % height);
+            game.setState(p.x(), p.y(), (r < 60) ? Board::Box : Board::Cross);
+        }
+    }
+
+    return buffer.data();
+}
+
+static QList<QByteArray> syntheticCorpus()
+{
+    static const int sizes[] = { 10, 15, 20, 30, 50 };
+
+    QList<QByteArray> corpus;
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (int j = 0; j < 4; j++) {
+            corpus << recordSession(sizes[i], sizes[i]);
+        }
+    }
+    return corpus;
+}
+
+static void refreshScene(Scene *scene, const SessionEvent &event)
+{
+    /* Mirrors the refreshes performed by MainWindow and Scene::press(). */
+    switch (event.type) {
+    case SessionEvent::SetState:
+    case SessionEvent::Undo: scene->refresh(event.pos); break;
+    case SessionEvent::Hint: scene->refresh(event.pos); scene->hover(event.pos.x(), event.pos.y()); break;
+    case SessionEvent::LoadState: scene->refresh(); break;
+    default: break;
+    }
+}
+
+static Result replay(const QList<QByteArray> &corpus, bool with_scene)
+{
+    Result result;
+    QElapsedTimer timer;
+
+    foreach (const QByteArray &log, corpus) {
+        SessionPlayer player(log);
+        if (!player.isValid()) {
+            continue;
+        }
+
+        QSharedPointer<Scene> scene;
+        if (with_scene) {
+            scene = QSharedPointer<Scene>(new Scene(player.game()));
+            scene->resize(QSize(1024, 768));
+        }
+
+        SessionEvent event;
+        forever {
+            const quint64 allocations = g_allocations;
+            timer.start();
+
+            if (!player.step(&event)) {
+                break;
+            }
+            if (scene) {
+                refreshScene(scene.data(), event);
+            }
+
+            const qint64 nsecs = timer.nsecsElapsed();
+            result.allocations += g_allocations - allocations;
+            result.nsecs += nsecs;
+            result.latencies.append(nsecs);
+        }
+
+        result.sessions++;
+    }
+
+    return result;
+}
+
+static qint64 percentile(const QVector<qint64> &sorted, int p)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    return sorted[qMin(sorted.size() - 1, sorted.size() * p / 100)];
+}
+
+static void report(QTextStream &out, const QString &mode, Result result)
+{
+    qSort(result.latencies);
+
+    const int events = result.latencies.size();
+    const double secs = result.nsecs / 1e9;
+
+    out << mode << ","
+        << result.sessions << ","
+        << events << ","
+        << ((secs > 0) ? qRound64(events / secs) : 0) << ","
+        << percentile(result.latencies, 50) << ","
+        << percentile(result.latencies, 99) << ","
+        << result.allocations << ","
+        << ((events > 0) ? (double)result.allocations / events : 0) << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+
+    /* The renderer looks for its theme relative to the working directory
+       before falling back to the installed location. */
+    if (!QFile::exists("themes/picmi.svg")) {
+        QDir::setCurrent(PICMI_SOURCE_DIR);
+    }
+
+    QStringList paths = app.arguments();
+    paths.removeFirst();
+
+    QList<QByteArray> corpus = paths.isEmpty() ? syntheticCorpus() : loadCorpus(paths);
+
+    QTextStream out(stdout);
+    out << "mode,sessions,events,events_per_sec,p50_ns,p99_ns,allocations,allocations_per_event\n";
+
+    report(out, "logic", replay(corpus, false));
+    report(out, "scene", replay(corpus, true));
+
+    return 0;
+}
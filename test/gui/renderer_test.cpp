@@ -0,0 +1,80 @@
+#include "renderer_test.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTest>
+
+#include "src/gui/renderer.h"
+
+QTEST_MAIN(RendererTest)
+
+/* Sets the size such that tiles are tilesize pixels large. Empty boards
+   predict no sizes, so nothing is rendered ahead of time behind the
+   test's back. */
+static QPixmap tiles(int tilesize)
+{
+    Renderer *renderer = Renderer::instance();
+    renderer->setSize(QSize(4 * tilesize, 4 * tilesize), 0, 0, QStringList());
+    return renderer->getPixmap(Renderer::Box);
+}
+
+void RendererTest::initTestCase()
+{
+    /* The renderer looks for its theme relative to the working directory
+       before falling back to the installed location. */
+    if (!QFile::exists("themes/picmi.svg")) {
+        QVERIFY(QDir::setCurrent(PICMI_SOURCE_DIR));
+    }
+}
+
+void RendererTest::testCacheStatistics()
+{
+    Renderer *renderer = Renderer::instance();
+    QSignalSpy changed(renderer, SIGNAL(tilesChanged()));
+
+    /* At these sizes, three tile sets fit into the cache but four do not. */
+
+    const int a = 460, b = 470, c = 480, d = 490;
+
+    /* Nothing to scale yet, rendered right away. */
+
+    QCOMPARE(tiles(a).width(), a);
+
+    /* b is superseded by c while still being rendered. It has been asked
+       for all the same and must not count as rendered ahead of time. */
+
+    tiles(b);
+    QCOMPARE(tiles(c).width(), c);
+    QVERIFY(changed.wait(30000));
+
+    Renderer::CacheStatistics statistics = renderer->cacheStatistics();
+    QCOMPARE(statistics.hits, 0);
+    QCOMPARE(statistics.misses, 3);
+    QCOMPARE(statistics.prewarmed, 0);
+    QCOMPARE(statistics.evictions, 0);
+    QCOMPARE(statistics.tile_sets, 3);
+
+    QCOMPARE(tiles(b).width(), b);
+
+    statistics = renderer->cacheStatistics();
+    QCOMPARE(statistics.hits, 1);
+    QCOMPARE(statistics.prewarm_hits, 0);
+
+    /* d evicts a, which has been used least recently. */
+
+    tiles(d);
+    QVERIFY(changed.wait(30000));
+
+    statistics = renderer->cacheStatistics();
+    QCOMPARE(statistics.misses, 4);
+    QCOMPARE(statistics.evictions, 1);
+    QCOMPARE(statistics.tile_sets, 3);
+    QVERIFY(statistics.bytes <= 48 * 1024 * 1024);
+
+    tiles(c);
+    QCOMPARE(renderer->cacheStatistics().hits, 2);
+
+    tiles(a);
+    QCOMPARE(renderer->cacheStatistics().misses, 5);
+}
@@ -0,0 +1,15 @@
+#ifndef __RENDERER_TEST_H
+#define __RENDERER_TEST_H
+
+#include <QObject>
+
+class RendererTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testCacheStatistics();
+};
+
+#endif /* __RENDERER_TEST_H */
@@ -0,0 +1,134 @@
+#include "gamejournal_test.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "gamejournal.h"
+#include "picmi.h"
+#include "testutil.h"
+
+QTEST_GUILESS_MAIN(GameJournalTest)
+
+void GameJournalTest::testEmpty()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    GameJournal journal(dir.path());
+    QVERIFY(journal.restore().isNull());
+}
+
+void GameJournalTest::testRestore()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QSharedPointer<Picmi> game(new Picmi(QSharedPointer<BoardMap>(new BoardMap(20, 20, 0.5)), true));
+    GameJournal journal(dir.path());
+    journal.start(game, "tag");
+
+    game->setState(0, 0, Board::Cross);
+    game->saveState();
+    game->setState(5, 5, Board::Box);
+    journal.snapshot();
+
+    /* These are only in the journal tail. */
+
+    game->setState(19, 19, Board::Cross);
+    game->setState(7, 3, Board::Box);
+    game->undo();
+    game->setState(3, 7, Board::Cross);
+
+    /* The first journal is left open, simulating a crash. */
+
+    QString tag;
+    GameJournal restored_journal(dir.path());
+    QSharedPointer<Picmi> restored = restored_journal.restore(&tag);
+    QVERIFY(!restored.isNull());
+    QCOMPARE(tag, QString("tag"));
+    QVERIFY(restored->preventMistakes());
+    QVERIFY(statesEqual(*game, *restored));
+    QCOMPARE(restored->undoStackSize(), game->undoStackSize());
+    QCOMPARE(restored->saveStackSize(), game->saveStackSize());
+
+    /* Journaling continues for the restored game. */
+
+    restored->setState(10, 10, Board::Cross);
+    restored->undo();
+    restored->undo();
+
+    QSharedPointer<Picmi> again = GameJournal(dir.path()).restore();
+    QVERIFY(!again.isNull());
+    QVERIFY(statesEqual(*restored, *again));
+    QCOMPARE(again->undoStackSize(), restored->undoStackSize());
+}
+
+void GameJournalTest::testTruncatedTail()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QSharedPointer<Picmi> game(new Picmi(QSharedPointer<BoardMap>(new BoardMap(10, 10, 0.5))));
+    GameJournal journal(dir.path());
+    journal.start(game, QString());
+    game->setState(1, 1, Board::Cross);
+    game->setState(2, 2, Board::Cross);
+
+    /* Chop off the final byte as if the last write had been interrupted. */
+
+    const QString path = dir.path() + "/game.pmsl";
+    QVERIFY(QFile::resize(path, QFileInfo(path).size() - 1));
+
+    QSharedPointer<Picmi> restored = GameJournal(dir.path()).restore();
+    QVERIFY(!restored.isNull());
+    QCOMPARE(restored->stateAt(1, 1), Board::Cross);
+    QCOMPARE(restored->stateAt(2, 2), Board::Nothing);
+}
+
+void GameJournalTest::testSkipsSnapshotted()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString path = dir.path() + "/game.pmsl";
+    QSharedPointer<Picmi> game(new Picmi(QSharedPointer<BoardMap>(new BoardMap(10, 10, 0.5))));
+    GameJournal journal(dir.path());
+    journal.start(game, QString());
+    const qint64 header_size = QFileInfo(path).size();
+
+    game->setState(1, 1, Board::Cross);
+    game->setState(2, 2, Board::Cross);
+    journal.snapshot();
+    game->setState(3, 3, Board::Cross);
+
+    /* Events covered by the snapshot are not read again, so garbling them
+       does not affect the restored game. */
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(header_size));
+    file.write("\xff\xff", 2);
+    file.close();
+
+    QSharedPointer<Picmi> restored = GameJournal(dir.path()).restore();
+    QVERIFY(!restored.isNull());
+    QVERIFY(statesEqual(*game, *restored));
+}
+
+void GameJournalTest::testDiscard()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QSharedPointer<Picmi> game(new Picmi(QSharedPointer<BoardMap>(new BoardMap(5, 5, 0.5))));
+    GameJournal journal(dir.path());
+    journal.start(game, QString());
+    game->setState(1, 1, Board::Cross);
+    QVERIFY(journal.game() == game);
+
+    journal.discard();
+    QVERIFY(journal.game().isNull());
+    QVERIFY(GameJournal(dir.path()).restore().isNull());
+}
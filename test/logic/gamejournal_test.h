@@ -0,0 +1,18 @@
+#ifndef __GAMEJOURNAL_TEST_H
+#define __GAMEJOURNAL_TEST_H
+
+#include <QObject>
+
+class GameJournalTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testEmpty();
+    void testRestore();
+    void testTruncatedTail();
+    void testSkipsSnapshotted();
+    void testDiscard();
+};
+
+#endif /* __GAMEJOURNAL_TEST_H */
@@ -0,0 +1,710 @@
+#include "levelloader_test.h"
+
+#include <KCompressionDevice>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "imageimporter.h"
+#include "levelcache.h"
+#include "levelindex.h"
+#include "levelloader.h"
+#include "levelpack.h"
+#include "puzzleimporter.h"
+#include "src/systemexception.h"
+
+QTEST_MAIN(LevelLoaderTest)
+
+/* Returns the sorted names of the levels matching query. */
+static QStringList matchNames(const LevelIndex &index, const QList<QSharedPointer<Level> > &levels,
+                              const QVector<int> &ids, const QString &query)
+{
+    const QBitArray matches = index.match(query);
+    QStringList names;
+    for (int i = 0; i < levels.size(); i++) {
+        if (matches.testBit(ids[i])) {
+            names.append(levels[i]->name());
+        }
+    }
+    names.sort();
+    return names;
+}
+
+QString LevelLoaderTest::writeLevelset(const QByteArray &xml)
+{
+    const QString path = QString("%1/levelset%2.xml").arg(m_dir.path()).arg(m_count++);
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(xml) != xml.size()) {
+        return QString();
+    }
+
+    return path;
+}
+
+QString LevelLoaderTest::writeFile(const QString &name, const QByteArray &contents)
+{
+    const QString path = m_dir.path() + "/" + name;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size()) {
+        return QString();
+    }
+
+    return path;
+}
+
+void LevelLoaderTest::testRows()
+{
+    LevelLoader loader(writeLevelset(
+        "<?xml version=\"1.0\"?>\n"
+        "<picmi name=\"Test\">\n"
+        "    <!-- comments are ignored -->\n"
+        "    <board name=\"A\" author=\"B\" difficulty=\"3\">\n"
+        "        <row>1--------1</row>\n"
+        "        <row>-11111111-</row>\n"
+        "        <row>----------</row>\n"
+        "    </board>\n"
+        "</picmi>\n"));
+
+    QSharedPointer<Level> level = loader.readLevel();
+    QVERIFY(!level.isNull());
+    QCOMPARE(level->levelset(), QString("Test"));
+    QCOMPARE(level->difficulty(), 3);
+    QCOMPARE(level->width(), 10);
+    QCOMPARE(level->height(), 3);
+    QCOMPARE(level->packedMap().boxCount(), 10);
+    QCOMPARE(level->packedMap().get(0, 0), Board::Box);
+    QCOMPARE(level->packedMap().get(9, 0), Board::Box);
+    QCOMPARE(level->packedMap().get(0, 1), Board::Nothing);
+    QCOMPARE(level->packedMap().get(8, 1), Board::Box);
+    QCOMPARE(level->map().size(), 30);
+    QCOMPARE(level->map()[9], Board::Box);
+    QCOMPARE(level->map()[10], Board::Nothing);
+
+    /* Games share a single board map, which refers to the level's bits. */
+    QSharedPointer<BoardMap> map = level->boardMap();
+    QVERIFY(map == level->boardMap());
+    QCOMPARE(map->packedMap().bits().constData(), level->packedMap().bits().constData());
+    QCOMPARE(map->boxCount(), 10);
+
+    QVERIFY(loader.readLevel().isNull());
+}
+
+void LevelLoaderTest::testInvalidLevels()
+{
+    LevelLoader loader(writeLevelset(
+        "<picmi name=\"Test\">\n"
+        "    <board name=\"Missing attribute\" author=\"B\"><row>1</row></board>\n"
+        "    <board name=\"Invalid char\" author=\"B\" difficulty=\"1\"><row>1x</row></board>\n"
+        "    <board name=\"Invalid size\" author=\"B\" difficulty=\"1\"><row>11</row><row>1</row></board>\n"
+        "    <board name=\"Mixed\" author=\"B\" difficulty=\"1\"><row>11</row><xpm>a.xpm</xpm></board>\n"
+        "    <board name=\"Empty\" author=\"B\" difficulty=\"1\"></board>\n"
+        "    <level name=\"Unexpected\" author=\"B\" difficulty=\"1\"><row>1</row></level>\n"
+        "    <board name=\"Valid\" author=\"B\" difficulty=\"1\"><row>-1</row></board>\n"
+        "</picmi>\n"));
+
+    QList<QSharedPointer<Level> > levels = loader.loadLevels();
+    QCOMPARE(levels.size(), 1);
+    QCOMPARE(levels[0]->width(), 2);
+    QCOMPARE(levels[0]->height(), 1);
+}
+
+void LevelLoaderTest::testSyntaxError()
+{
+    /* Levels preceding the error are kept. */
+
+    LevelLoader loader(writeLevelset(
+        "<picmi name=\"Test\">\n"
+        "    <board name=\"A\" author=\"B\" difficulty=\"1\"><row>1</row></board>\n"
+        "    <board name=\"C\" author=\"B\" difficulty=\"1\"><row>1</board>\n"
+        "</picmi>\n"));
+
+    QCOMPARE(loader.loadLevels().size(), 1);
+}
+
+void LevelLoaderTest::testNoLevelsetName()
+{
+    LevelLoader loader(writeLevelset(
+        "<picmi>\n"
+        "    <board name=\"A\" author=\"B\" difficulty=\"1\"><row>1</row></board>\n"
+        "</picmi>\n"));
+
+    QVERIFY(loader.loadLevels().isEmpty());
+}
+
+void LevelLoaderTest::testDefaultLevels()
+{
+    LevelLoader loader(PICMI_SOURCE_DIR "/levels/default.xml");
+    QList<QSharedPointer<Level> > levels = loader.loadLevels();
+    QCOMPARE(levels.size(), 52);
+
+    /* Rows and xpm images. */
+
+    QCOMPARE(levels[0]->levelset(), QString("Default"));
+    QVERIFY(!levels[0]->packedMap().isNull());
+    QCOMPARE(levels[1]->width(), 19);
+    QCOMPARE(levels[1]->height(), 19);
+    QCOMPARE(levels[1]->packedMap().get(7, 0), Board::Box);
+    QCOMPARE(levels[1]->packedMap().get(6, 0), Board::Nothing);
+}
+
+void LevelLoaderTest::testCache()
+{
+    const QString path = writeLevelset(
+        "<picmi name=\"Test\">\n"
+        "    <board name=\"A\" author=\"B\" difficulty=\"2\"><row>1-1</row><row>-1-</row></board>\n"
+        "    <board name=\"C\" author=\"D\" difficulty=\"5\"><row>1111111111</row></board>\n"
+        "</picmi>\n");
+    const QString cache_path = m_dir.path() + "/levels.cache";
+
+    QList<LevelsetFile> files;
+    files << LevelsetFile(path);
+    QList<QList<QSharedPointer<Level> > > levels;
+    levels << LevelLoader::loadLevelset(path);
+    QCOMPARE(levels[0].size(), 2);
+
+    QVERIFY(LevelCache(cache_path).isStale(files));
+    QVERIFY(LevelCache::write(cache_path, files, levels));
+
+    QList<QSharedPointer<Level> > cached;
+    {
+        LevelCache cache(cache_path);
+        QVERIFY(!cache.isStale(files));
+        QVERIFY(cache.lookup(files[0], &cached));
+    }
+
+    /* Cached maps refer to the mapping, which outlives the cache. */
+
+    QCOMPARE(cached.size(), 2);
+    for (int i = 0; i < cached.size(); i++) {
+        QCOMPARE(cached[i]->levelset(), levels[0][i]->levelset());
+        QCOMPARE(cached[i]->difficulty(), levels[0][i]->difficulty());
+        QVERIFY(cached[i]->packedMap() == levels[0][i]->packedMap());
+        QVERIFY(*cached[i] == *levels[0][i]);
+    }
+
+    /* Modified levelsets are not returned. */
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write("\n");
+    file.close();
+
+    LevelCache cache(cache_path);
+    QVERIFY(cache.isStale(QList<LevelsetFile>() << LevelsetFile(path)));
+    QVERIFY(!cache.lookup(LevelsetFile(path), &cached));
+}
+
+void LevelLoaderTest::testPack()
+{
+    QList<QSharedPointer<Level> > levels =
+            LevelLoader::loadLevelset(PICMI_SOURCE_DIR "/levels/default.xml");
+    const QString path = m_dir.path() + "/default" + LevelPack::SUFFIX;
+    QVERIFY(LevelPack::write(path, levels));
+
+    {
+        LevelPack pack(path);
+        QCOMPARE(pack.count(), levels.size());
+
+        QList<QSharedPointer<Level> > packed = pack.levels();
+        QCOMPARE(packed.size(), levels.size());
+        for (int i = 0; i < packed.size(); i++) {
+            QVERIFY(*packed[i] == *levels[i]);
+            QCOMPARE(packed[i]->levelset(), levels[i]->levelset());
+            QCOMPARE(packed[i]->difficulty(), levels[i]->difficulty());
+            QVERIFY(packed[i]->packedMap() == levels[i]->packedMap());
+            QCOMPARE(packed[i]->metadata().boxes, levels[i]->metadata().boxes);
+            QCOMPARE(packed[i]->metadata().clues, levels[i]->metadata().clues);
+            QCOMPARE(packed[i]->metadata().wide_row, levels[i]->metadata().wide_row);
+            QCOMPARE(packed[i]->metadata().guesses, levels[i]->metadata().guesses);
+            QCOMPARE(packed[i]->metadata().unique, levels[i]->metadata().unique);
+        }
+
+        /* Levels stay valid after the pack itself is gone. */
+
+        levels = packed;
+    }
+    QCOMPARE(levels[1]->packedMap().get(7, 0), Board::Box);
+    QCOMPARE(LevelLoader::loadLevelset(path).size(), levels.size());
+
+    /* Truncated packs are rejected. */
+
+    const QString truncated = m_dir.path() + "/truncated" + LevelPack::SUFFIX;
+    QVERIFY(QFile::copy(path, truncated));
+    QVERIFY(QFile::resize(truncated, 100));
+
+    bool thrown = false;
+    try {
+        LevelPack pack(truncated);
+    } catch (const SystemException &) {
+        thrown = true;
+    }
+    QVERIFY(thrown);
+    QVERIFY(LevelLoader::loadLevelset(truncated).isEmpty());
+
+    /* Huge sizes are rejected before anything is allocated for them. */
+
+    const QString huge = writeFile("huge.cwc", "100000\n100000\n");
+    QVERIFY(LevelLoader::loadLevelset(huge).isEmpty());
+
+    const QString huge_goal = writeFile("huge.non",
+        "width 65536\n"
+        "height 65536\n"
+        "goal \"0\"\n");
+    QVERIFY(LevelLoader::loadLevelset(huge_goal).isEmpty());
+}
+
+void LevelLoaderTest::testPreview()
+{
+    LevelLoader loader(writeLevelset(
+        "<picmi name=\"Test\">\n"
+        "    <board name=\"A\" author=\"B\" difficulty=\"1\">\n"
+        "        <row>1--------1</row>\n"
+        "        <row>-11111111-</row>\n"
+        "    </board>\n"
+        "</picmi>\n"));
+    QSharedPointer<Level> level = loader.readLevel();
+    QVERIFY(!level.isNull());
+
+    const QImage preview = level->preview().toImage();
+    QCOMPARE(preview.size(), QSize(10, 2));
+    for (int y = 0; y < level->height(); y++) {
+        for (int x = 0; x < level->width(); x++) {
+            const QRgb expected = (level->packedMap().get(x, y) == Board::Box)
+                    ? qRgb(0, 0, 0) : qRgb(255, 255, 255);
+            QCOMPARE(preview.pixel(x, y) & 0xffffff, expected & 0xffffff);
+        }
+    }
+
+    /* Scaled previews keep the aspect ratio. */
+
+    QCOMPARE(level->preview(QSize(100, 100)).size(), QSize(100, 20));
+}
+
+void LevelLoaderTest::testDeduplicate()
+{
+    LevelLoader loader(writeLevelset(
+        "<picmi name=\"Test\">\n"
+        "    <board name=\"A\" author=\"X\" difficulty=\"1\"><row>11-</row><row>1--</row></board>\n"
+        "    <board name=\"A\" author=\"X\" difficulty=\"1\"><row>111</row><row>111</row></board>\n"
+        "    <board name=\"Same map\" author=\"X\" difficulty=\"1\"><row>11-</row><row>1--</row></board>\n"
+        "    <board name=\"Rotated\" author=\"X\" difficulty=\"1\"><row>11</row><row>-1</row><row>--</row></board>\n"
+        "    <board name=\"Mirrored\" author=\"X\" difficulty=\"1\"><row>-11</row><row>--1</row></board>\n"
+        "    <board name=\"Distinct\" author=\"X\" difficulty=\"1\"><row>1-1</row><row>1--</row></board>\n"
+        "</picmi>\n"));
+    QList<QSharedPointer<Level> > levels = loader.loadLevels();
+    QCOMPARE(levels.size(), 6);
+
+    const PackedMap &map = levels[0]->packedMap();
+    QCOMPARE(map.hash(PackedMap::Identity), map.hash());
+    QCOMPARE(map.hash(PackedMap::Rotate90), levels[3]->mapHash());
+    QCOMPARE(map.hash(PackedMap::Mirror), levels[4]->mapHash());
+    QCOMPARE(levels[3]->packedMap().canonicalHash(), map.canonicalHash());
+    QVERIFY(levels[5]->packedMap().canonicalHash() != map.canonicalHash());
+
+    QList<QSharedPointer<Level> > unique = LevelLoader::deduplicate(levels, false);
+    QCOMPARE(unique.size(), 4);
+    QVERIFY(unique[0] == levels[0]);
+    QVERIFY(unique[1] == levels[3]);
+    QVERIFY(unique[2] == levels[4]);
+    QVERIFY(unique[3] == levels[5]);
+
+    unique = LevelLoader::deduplicate(levels, true);
+    QCOMPARE(unique.size(), 2);
+    QVERIFY(unique[0] == levels[0]);
+    QVERIFY(unique[1] == levels[5]);
+}
+
+void LevelLoaderTest::testImageImport()
+{
+    /* Rows wider than a byte: transparent and light pixels are empty, dark
+     * pixels are boxes. */
+
+    QImage argb(10, 2, QImage::Format_ARGB32);
+    argb.fill(qRgba(0, 0, 0, 0));
+    argb.setPixel(0, 0, qRgb(0, 0, 0));
+    argb.setPixel(9, 0, qRgb(100, 100, 100));
+    argb.setPixel(8, 1, qRgb(200, 200, 200));
+
+    ImageImporter importer;
+    PackedMap map = importer.convert(argb);
+    QCOMPARE(map.width(), 10);
+    QCOMPARE(map.height(), 2);
+    QCOMPARE(map.boxCount(), 2);
+    QCOMPARE(map.get(0, 0), Board::Box);
+    QCOMPARE(map.get(9, 0), Board::Box);
+    QCOMPARE(map.get(8, 1), Board::Nothing);
+
+    importer.setThreshold(250);
+    QCOMPARE(importer.convert(argb).get(8, 1), Board::Box);
+    importer.setThreshold(50);
+    QCOMPARE(importer.convert(argb).boxCount(), 1);
+
+    /* PBM and PNG files give the same map. */
+
+    importer.setThreshold(128);
+    const QString pbm = m_dir.path() + "/image.pbm";
+    const QString png = m_dir.path() + "/image.png";
+    QImage opaque(10, 2, QImage::Format_RGB32);
+    opaque.fill(qRgb(255, 255, 255));
+    opaque.setPixel(0, 0, qRgb(0, 0, 0));
+    opaque.setPixel(9, 0, qRgb(0, 0, 0));
+    QVERIFY(opaque.convertToFormat(QImage::Format_Mono, Qt::MonoOnly | Qt::ThresholdDither).save(pbm));
+    QVERIFY(argb.save(png));
+    QVERIFY(importer.load(pbm) == map);
+    QVERIFY(importer.load(png) == map);
+
+    /* Dithering a mid grey sets some but not all cells. */
+
+    QImage grey(16, 16, QImage::Format_RGB32);
+    grey.fill(qRgb(128, 128, 128));
+    importer.setMode(ImageImporter::Dither);
+    const int boxes = importer.convert(grey).boxCount();
+    QVERIFY(boxes > 0 && boxes < 16 * 16);
+
+    /* Levelsets may refer to any supported image. */
+
+    LevelLoader loader(writeLevelset(
+        "<?xml version=\"1.0\"?>\n"
+        "<picmi name=\"Test\">\n"
+        "    <board name=\"A\" author=\"B\" difficulty=\"3\">\n"
+        "        <image threshold=\"250\">image.png</image>\n"
+        "    </board>\n"
+        "</picmi>\n"));
+    QSharedPointer<Level> level = loader.readLevel();
+    QVERIFY(!level.isNull());
+    QCOMPARE(level->packedMap().boxCount(), 3);
+
+    QSharedPointer<Level> imported = ImageImporter().loadLevel(pbm, "Images", "B");
+    QVERIFY(!imported.isNull());
+    QCOMPARE(imported->name(), QString("image"));
+    QVERIFY(imported->packedMap() == map);
+    QVERIFY(ImageImporter().loadLevel(m_dir.path() + "/missing.png", "Images", "B").isNull());
+}
+
+void LevelLoaderTest::testPuzzleImport()
+{
+    /* All files describe the same cross:
+     * .X.
+     * XXX
+     * .X. */
+
+    PackedMap cross(3, 3);
+    cross.set(1, 0, Board::Box);
+    cross.set(0, 1, Board::Box);
+    cross.set(1, 1, Board::Box);
+    cross.set(2, 1, Board::Box);
+    cross.set(1, 2, Board::Box);
+
+    /* webpbn: a set of a solved, a clue-only, a multicolor and an
+     * unsolvable puzzle. */
+
+    const QString pbn = writeFile("set.pbn",
+        "<?xml version=\"1.0\"?>\n"
+        "<puzzleset>\n"
+        "<puzzle type=\"grid\" defaultcolor=\"black\">\n"
+        "  <title>Cross</title><author>A</author>\n"
+        "  <color name=\"white\" char=\".\">fff</color>\n"
+        "  <color name=\"black\" char=\"X\">000</color>\n"
+        "  <solution type=\"goal\"><image>\n|.X.|\n|XXX|\n|.X.|\n</image></solution>\n"
+        "</puzzle>\n"
+        "<puzzle>\n"
+        "  <clues type=\"columns\"><line><count>1</count></line><line><count>3</count></line>"
+        "<line><count>1</count></line></clues>\n"
+        "  <clues type=\"rows\"><line><count>1</count></line><line><count>3</count></line>"
+        "<line><count>1</count></line></clues>\n"
+        "</puzzle>\n"
+        "<puzzle>\n"
+        "  <clues type=\"columns\"><line><count color=\"red\">1</count></line></clues>\n"
+        "  <clues type=\"rows\"><line><count>1</count></line></clues>\n"
+        "</puzzle>\n"
+        "<puzzle>\n"
+        "  <clues type=\"columns\"><line><count>1</count></line></clues>\n"
+        "  <clues type=\"rows\"><line><count>2</count></line></clues>\n"
+        "</puzzle>\n"
+        "</puzzleset>\n");
+
+    QVERIFY(PuzzleImporter::canImport(pbn));
+    QList<QSharedPointer<Level> > levels = LevelLoader::loadLevelset(pbn);
+    QCOMPARE(levels.size(), 2);
+    QCOMPARE(levels[0]->name(), QString("Cross"));
+    QCOMPARE(levels[0]->author(), QString("A"));
+    QCOMPARE(levels[0]->levelset(), QString("set"));
+    QVERIFY(levels[0]->packedMap() == cross);
+    QVERIFY(levels[1]->packedMap() == cross);
+
+    const QString non = writeFile("cross.non",
+        "title \"Cross\"\n"
+        "by \"A\"\n"
+        "width 3\n"
+        "height 3\n"
+        "\n"
+        "rows\n"
+        "1\n"
+        "3\n"
+        "1\n"
+        "\n"
+        "columns\n"
+        "1\n"
+        "3\n"
+        "1\n");
+    levels = LevelLoader::loadLevelset(non);
+    QCOMPARE(levels.size(), 1);
+    QCOMPARE(levels[0]->name(), QString("Cross"));
+    QVERIFY(levels[0]->packedMap() == cross);
+
+    const QString goal = writeFile("goal.non",
+        "width 3\n"
+        "height 3\n"
+        "goal \"010111010\"\n");
+    levels = LevelLoader::loadLevelset(goal);
+    QCOMPARE(levels.size(), 1);
+    QVERIFY(levels[0]->packedMap() == cross);
+
+    const QString cwc = writeFile("cross.cwc", "3\n3\n1\n3\n1\n1\n3\n1\n");
+    levels = LevelLoader::loadLevelset(cwc);
+    QCOMPARE(levels.size(), 1);
+    QVERIFY(levels[0]->packedMap() == cross);
+
+    const QString truncated = writeFile("truncated.cwc", "3\n3\n1\n3\n");
+    QVERIFY(LevelLoader::loadLevelset(truncated).isEmpty());
+}
+
+void LevelLoaderTest::testLibrary()
+{
+    /* The relative "levels/" search path is used, the level cache goes to
+     * the test location. */
+
+    qRegisterMetaType<QList<QSharedPointer<Level> > >("QList<QSharedPointer<Level> >");
+    QStandardPaths::setTestModeEnabled(true);
+    const QString cwd = QDir::currentPath();
+    QVERIFY(QDir(m_dir.path()).mkpath("library/levels"));
+    QVERIFY(QDir::setCurrent(m_dir.path() + "/library"));
+
+    const QString first = writeFile("library/levels/first.xml",
+        "<picmi name=\"First\">\n"
+        "    <board name=\"A\" author=\"X\" difficulty=\"1\"><row>1-1</row></board>\n"
+        "    <board name=\"B\" author=\"X\" difficulty=\"1\"><row>11-</row></board>\n"
+        "</picmi>\n");
+
+    LevelLibrary library;
+    QSignalSpy loaded(&library, SIGNAL(loaded()));
+    QSignalSpy added(&library, SIGNAL(levelsAdded(QList<QSharedPointer<Level> >)));
+    QSignalSpy removed(&library, SIGNAL(levelsRemoved(QList<QSharedPointer<Level> >)));
+
+    library.start();
+    QVERIFY(loaded.wait());
+    const int count = library.levels().size();
+    QVERIFY(count >= 2);
+
+    /* A new file only adds its own levels, the others are kept. */
+
+    const QList<QSharedPointer<Level> > before = library.levels();
+    added.clear();
+    writeFile("library/levels/second.xml",
+        "<picmi name=\"Second\">\n"
+        "    <board name=\"C\" author=\"X\" difficulty=\"1\"><row>111</row></board>\n"
+        "</picmi>\n");
+    QVERIFY(added.wait());
+    QCOMPARE(removed.count(), 0);
+    QCOMPARE(library.levels().size(), count + 1);
+    for (int i = 0; i < before.size(); i++) {
+        QVERIFY(library.levels().contains(before[i]));
+    }
+
+    /* Editing a file replaces just its levels. */
+
+    added.clear();
+    writeFile("library/levels/first.xml",
+        "<picmi name=\"First\">\n"
+        "    <board name=\"A\" author=\"X\" difficulty=\"1\"><row>1-1</row></board>\n"
+        "</picmi>\n");
+    QVERIFY(removed.wait());
+    QCOMPARE(added.count(), 1);
+    QCOMPARE(library.levels().size(), count);
+
+    /* Deleting a file evicts its levels. */
+
+    removed.clear();
+    QVERIFY(QFile::remove(first));
+    QVERIFY(removed.wait());
+    QCOMPARE(library.levels().size(), count - 1);
+
+    QDir::setCurrent(cwd);
+    QStandardPaths::setTestModeEnabled(false);
+}
+
+void LevelLoaderTest::testSortKey()
+{
+    const QString path = writeLevelset(
+        "<picmi name=\"Names\">\n"
+        "    <board name=\"beta\" author=\"X\" difficulty=\"1\"><row>1</row></board>\n"
+        "    <board name=\"Alpha\" author=\"X\" difficulty=\"1\"><row>1</row></board>\n"
+        "</picmi>\n");
+    const QList<QSharedPointer<Level> > levels = LevelLoader(path).loadLevels();
+    QCOMPARE(levels.size(), 2);
+
+    /* Keys order like the collator and are reused until the language
+     * changes. */
+
+    QCollator collator;
+    QCOMPARE(levels[0]->sortKey().compare(levels[1]->sortKey()) > 0,
+             collator.compare(levels[0]->name(), levels[1]->name()) > 0);
+    QCOMPARE(&levels[0]->sortKey(), &levels[0]->sortKey());
+    QCOMPARE(levels[0]->name(), QString("beta"));
+
+    Level::languageChanged();
+    QCOMPARE(levels[0]->name(), QString("beta"));
+    QCOMPARE(levels[0]->sortKey().compare(levels[1]->sortKey()) > 0,
+             collator.compare(levels[0]->name(), levels[1]->name()) > 0);
+}
+
+void LevelLoaderTest::testIndex()
+{
+    const QString path = writeLevelset(
+        "<picmi name=\"Animals\">\n"
+        "    <board name=\"Cat\" author=\"Jane Doe\" difficulty=\"2\"><row>1-1</row></board>\n"
+        "    <board name=\"Dog\" author=\"John\" difficulty=\"5\"><row>11-</row><row>-11</row></board>\n"
+        "    <board name=\"Bird\" author=\"jane\" difficulty=\"7\"><row>1</row></board>\n"
+        "</picmi>\n");
+    QList<QSharedPointer<Level> > levels = LevelLoader(path).loadLevels();
+    QCOMPARE(levels.size(), 3);
+
+    LevelIndex index;
+    QVector<int> ids = index.insert(levels);
+    QCOMPARE(index.size(), 3);
+
+    const QStringList all = QStringList() << "Bird" << "Cat" << "Dog";
+    QCOMPARE(matchNames(index, levels, ids, ""), all);
+    QCOMPARE(matchNames(index, levels, ids, "animals"), all);
+    QCOMPARE(matchNames(index, levels, ids, "unsolved"), all);
+    QCOMPARE(matchNames(index, levels, ids, "solved"), QStringList());
+    QCOMPARE(matchNames(index, levels, ids, "author:JANE"), QStringList() << "Bird" << "Cat");
+    QCOMPARE(matchNames(index, levels, ids, "jo"), QStringList() << "Dog");
+    QCOMPARE(matchNames(index, levels, ids, "set:dog"), QStringList());
+    QCOMPARE(matchNames(index, levels, ids, "difficulty>=5"), QStringList() << "Bird" << "Dog");
+    QCOMPARE(matchNames(index, levels, ids, "difficulty<5"), QStringList() << "Cat");
+    QCOMPARE(matchNames(index, levels, ids, "width=3  height>1"), QStringList() << "Dog");
+    QCOMPARE(matchNames(index, levels, ids, "size>=3"), QStringList() << "Cat" << "Dog");
+    QCOMPARE(matchNames(index, levels, ids, "author:jane difficulty>5"), QStringList() << "Bird");
+    QCOMPARE(matchNames(index, levels, ids, "time<100"), QStringList());
+
+    /* Names of unsolved levels are masked and not searchable. */
+
+    QCOMPARE(matchNames(index, levels, ids, "cat"), QStringList());
+
+    /* Removed levels no longer match, their ids are reused. */
+
+    index.remove(QVector<int>() << ids[0]);
+    QCOMPARE(index.match("author:jane").count(true), 1);
+    QCOMPARE(index.match("").count(true), 2);
+
+    const QVector<int> reinserted = index.insert(QList<QSharedPointer<Level> >() << levels[0]);
+    QCOMPARE(reinserted, QVector<int>() << ids[0]);
+    QCOMPARE(matchNames(index, levels, ids, "author:jane"), QStringList() << "Bird" << "Cat");
+}
+
+void LevelLoaderTest::testMetadata()
+{
+    const QString levelset = writeLevelset(
+        "<picmi name=\"Metadata\">\n"
+        "    <board name=\"A\" author=\"X\" difficulty=\"1\">\n"
+        "        <row>1-11-1</row><row>------</row><row>111-11</row>\n"
+        "    </board>\n"
+        "</picmi>\n");
+    LevelLoader loader(levelset);
+    const QSharedPointer<Level> level = loader.readLevel();
+    QVERIFY(level);
+
+    const LevelMetadata &metadata = level->metadata();
+    QVERIFY(metadata.isValid());
+    QCOMPARE(metadata.boxes, 9);
+    QCOMPARE(metadata.cells, 18);
+    QCOMPARE(metadata.density(), 0.5);
+    QCOMPARE(metadata.clues, 14);
+    QCOMPARE(metadata.max_clue, 3);
+
+    /* "1 2 1" is the widest row, column 0 the first with two clues. */
+
+    QCOMPARE(metadata.row_text_length, 5);
+    QCOMPARE(metadata.wide_row, 0);
+    QCOMPARE(metadata.wide_digit_row, 0);
+    QCOMPARE(metadata.col_clue_count, 2);
+    QCOMPARE(metadata.tall_col, 0);
+
+    QVERIFY(metadata.unique);
+    QCOMPARE(metadata.guesses, 0);
+
+    /* Large maps are analyzed, but not solved. */
+
+    const LevelMetadata large(BoardMap(100, 100, 0.5));
+    QVERIFY(large.isValid());
+    QCOMPARE(large.cells, 10000);
+    QCOMPARE(large.guesses, -1);
+    QVERIFY(!large.unique);
+
+    /* Metadata survives the level cache. */
+
+    const QString path = m_dir.path() + "/metadata.cache";
+    const LevelsetFile file(levelset);
+    QVERIFY(LevelCache::write(path, QList<LevelsetFile>() << file,
+                              QList<QList<QSharedPointer<Level> > >()
+                              << (QList<QSharedPointer<Level> >() << level)));
+
+    QList<QSharedPointer<Level> > cached;
+    QVERIFY(LevelCache(path).lookup(file, &cached));
+    QCOMPARE(cached.size(), 1);
+    QCOMPARE(cached[0]->metadata().clues, 14);
+    QCOMPARE(cached[0]->metadata().tall_col, 0);
+    QVERIFY(cached[0]->metadata().unique);
+}
+
+void LevelLoaderTest::testCompressed()
+{
+    /* Levelsets are parsed while they are decompressed. */
+
+    const QString xml = m_dir.path() + "/compressed.xml.gz";
+    {
+        KCompressionDevice out(xml, KCompressionDevice::GZip);
+        QVERIFY(out.open(QIODevice::WriteOnly));
+        out.write("<picmi name=\"Compressed\">\n");
+        for (int i = 0; i < 100; i++) {
+            out.write(QString("    <board name=\"L%1\" author=\"X\" difficulty=\"1\">"
+                              "<row>1-----1111</row></board>\n").arg(i).toUtf8());
+        }
+        out.write("</picmi>\n");
+    }
+    QVERIFY(LevelLoader::isCompressed(xml));
+
+    const QList<QSharedPointer<Level> > levels = LevelLoader::loadLevelset(xml);
+    QCOMPARE(levels.size(), 100);
+    QCOMPARE(levels[99]->name(), QString("L99"));
+    QCOMPARE(levels[99]->width(), 10);
+
+    /* Compressed packs are decompressed into memory, their levels stay
+       valid without the pack. */
+
+    const QString pack = m_dir.path() + "/compressed" + LevelPack::SUFFIX + LevelLoader::COMPRESSED_SUFFIX;
+    QVERIFY(LevelPack::isPack(pack));
+    QVERIFY(LevelPack::write(pack, levels));
+    QVERIFY(QFileInfo(pack).size() < 100 * 64);
+
+    QList<QSharedPointer<Level> > packed;
+    {
+        LevelPack p(pack);
+        QCOMPARE(p.count(), 100);
+        packed = p.levels();
+    }
+    QCOMPARE(packed.size(), 100);
+    QCOMPARE(packed[99]->name(), QString("L99"));
+    QVERIFY(packed[99]->packedMap() == levels[99]->packedMap());
+
+    /* Corrupt data is rejected. */
+
+    const QString corrupt = writeFile("corrupt.xml.gz", "not compressed");
+    QVERIFY(LevelLoader::loadLevelset(corrupt).isEmpty());
+}
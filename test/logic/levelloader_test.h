@@ -0,0 +1,40 @@
+#ifndef __LEVELLOADER_TEST_H
+#define __LEVELLOADER_TEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class LevelLoaderTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    LevelLoaderTest() : m_count(0) { }
+
+private slots:
+    void testRows();
+    void testInvalidLevels();
+    void testSyntaxError();
+    void testNoLevelsetName();
+    void testDefaultLevels();
+    void testCache();
+    void testPack();
+    void testPreview();
+    void testDeduplicate();
+    void testImageImport();
+    void testPuzzleImport();
+    void testLibrary();
+    void testSortKey();
+    void testIndex();
+    void testMetadata();
+    void testCompressed();
+
+private:
+    QString writeLevelset(const QByteArray &xml);
+    QString writeFile(const QString &name, const QByteArray &contents);
+
+    QTemporaryDir m_dir;
+    int m_count;
+};
+
+#endif /* __LEVELLOADER_TEST_H */
@@ -0,0 +1,136 @@
+#include "sessionlog_test.h"
+
+#include <QBuffer>
+#include <QTest>
+
+#include "sessionlog.h"
+#include "testutil.h"
+
+QTEST_GUILESS_MAIN(SessionLogTest)
+
+void SessionLogTest::testHeader()
+{
+    QSharedPointer<BoardMap> map = generateMap("b.b\n.b.");
+    Picmi game(map, true);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    game.setRecorder(QSharedPointer<SessionRecorder>(new SessionRecorder(&buffer)));
+
+    SessionReader reader(buffer.data());
+    QVERIFY(reader.isValid());
+    QVERIFY(reader.preventMistakes());
+    QCOMPARE(reader.mapHash(), SessionRecorder::hash(*map));
+    QCOMPARE(reader.map()->width(), 3);
+    QCOMPARE(reader.map()->height(), 2);
+    QCOMPARE(reader.map()->get(1, 1), Board::Box);
+    QCOMPARE(reader.map()->get(1, 0), Board::Nothing);
+
+    SessionEvent event;
+    QVERIFY(!reader.readEvent(&event));
+}
+
+void SessionLogTest::testInvalid()
+{
+    QVERIFY(!SessionReader(QByteArray()).isValid());
+    QVERIFY(!SessionReader(QByteArray("PMSL")).isValid());
+    QVERIFY(!SessionPlayer(QByteArray("garbage")).isValid());
+
+    /* A corrupted map must be detected through the hash. */
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    SessionRecorder recorder(&buffer);
+    recorder.begin(*generateMap("bb\n.."), false);
+
+    QByteArray data = buffer.data();
+    data[data.size() - 1] = data[data.size() - 1] ^ 0x01;
+    QVERIFY(!SessionReader(data).isValid());
+
+    /* Dimensions of 2^33 each, whose product wraps around to zero. */
+
+    QByteArray huge = buffer.data().left(5); /* magic and version */
+    for (int i = 0; i < 2; i++) {
+        huge.append("\x80\x80\x80\x80\x20", 5);
+    }
+    huge.append(QByteArray(1 + 8, '\0'));
+    QVERIFY(!SessionReader(huge).isValid());
+
+    /* Players can't set cells to Nothing. */
+
+    data = buffer.data();
+    data.append((char)(SessionEvent::SetState | (Board::Nothing << 3)));
+    data.append(QByteArray(3, '\0'));
+    SessionReader nothing(data);
+    QVERIFY(nothing.isValid());
+    SessionEvent event;
+    QVERIFY(!nothing.readEvent(&event));
+}
+
+void SessionLogTest::testRoundTrip()
+{
+    QSharedPointer<BoardMap> map = generateMap("bb.b.\n"
+                                               ".bbb.\n"
+                                               "b...b");
+    Picmi game(map);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    game.setRecorder(QSharedPointer<SessionRecorder>(new SessionRecorder(&buffer)));
+
+    game.setState(0, 0, Board::Box);
+    game.setState(4, 0, Board::Cross);
+    game.saveState();
+    game.setState(2, 0, Board::Box);
+    game.setState(3, 1, Board::Box);
+    game.loadState();
+    game.setState(3, 1, Board::Cross);
+    game.undo();
+    game.hintAt(QPoint(1, 1));
+
+    for (int y = 0; y < map->height(); y++) {
+        for (int x = 0; x < map->width(); x++) {
+            if (map->get(x, y) == Board::Box && game.stateAt(x, y) != Board::Box) {
+                game.setState(x, y, Board::Box);
+            }
+        }
+    }
+
+    SessionPlayer player(buffer.data());
+    QVERIFY(player.isValid());
+
+    int events = 0;
+    SessionEvent event;
+    while (player.step(&event)) {
+        events++;
+    }
+
+    QCOMPARE(events, 15);
+    QCOMPARE(event.type, SessionEvent::SetState);
+    QCOMPARE(event.pos, QPoint(4, 2));
+    QVERIFY(player.won());
+    QVERIFY(statesEqual(game, *player.game()));
+}
+
+void SessionLogTest::testLargeBoard()
+{
+    /* Coordinate deltas exceed a single varint byte. */
+
+    QSharedPointer<BoardMap> map(new BoardMap(300, 200, 0.5));
+    Picmi game(map);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    game.setRecorder(QSharedPointer<SessionRecorder>(new SessionRecorder(&buffer)));
+
+    game.setState(299, 199, Board::Cross);
+    game.setState(0, 0, Board::Box);
+    game.setState(150, 3, Board::Box);
+    game.setState(7, 198, Board::Cross);
+
+    SessionPlayer player(buffer.data());
+    QVERIFY(player.isValid());
+    player.playAll();
+
+    QVERIFY(statesEqual(game, *player.game()));
+}
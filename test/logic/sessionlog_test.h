@@ -0,0 +1,17 @@
+#ifndef __SESSIONLOG_TEST_H
+#define __SESSIONLOG_TEST_H
+
+#include <QObject>
+
+class SessionLogTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testHeader();
+    void testInvalid();
+    void testRoundTrip();
+    void testLargeBoard();
+};
+
+#endif /* __SESSIONLOG_TEST_H */
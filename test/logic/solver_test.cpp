@@ -0,0 +1,98 @@
+#include "solver_test.h"
+
+#include <QTest>
+
+#include "boardmap.h"
+#include "solver.h"
+
+QTEST_GUILESS_MAIN(SolverTest)
+
+static QVector<int> clues(const QString &s)
+{
+    QVector<int> c;
+    const QStringList numbers = s.split(' ', QString::SkipEmptyParts);
+    for (int i = 0; i < numbers.size(); i++) {
+        c.append(numbers[i].toInt());
+    }
+    return c;
+}
+
+void SolverTest::testUnique()
+{
+    /* .X.
+     * XXX
+     * .X. */
+
+    QVector<QVector<int> > rows, cols;
+    rows << clues("1") << clues("3") << clues("1");
+    cols << clues("1") << clues("3") << clues("1");
+
+    Solver solver(rows, cols);
+    QCOMPARE(solver.solve(), Solver::Unique);
+    QCOMPARE(solver.guesses(), 0);
+
+    const PackedMap map = solver.solution();
+    QCOMPARE(map.boxCount(), 5);
+    QCOMPARE(map.get(0, 0), Board::Nothing);
+    QCOMPARE(map.get(1, 0), Board::Box);
+    QCOMPARE(map.get(0, 1), Board::Box);
+}
+
+void SolverTest::testMultiple()
+{
+    /* Both diagonals of a 2x2 board match. */
+
+    QVector<QVector<int> > rows, cols;
+    rows << clues("1") << clues("1");
+    cols << clues("1") << clues("1");
+
+    Solver solver(rows, cols);
+    QCOMPARE(solver.solve(), Solver::Multiple);
+    QVERIFY(solver.guesses() > 0);
+    QCOMPARE(solver.solution().boxCount(), 2);
+}
+
+void SolverTest::testContradiction()
+{
+    QVector<QVector<int> > rows, cols;
+    rows << clues("2");
+    cols << clues("1") << clues("");
+
+    Solver solver(rows, cols);
+    QCOMPARE(solver.solve(), Solver::Contradiction);
+    QVERIFY(solver.solution().isNull());
+}
+
+void SolverTest::testRandom()
+{
+    /* Any solution found must reproduce the clues, and unique solutions
+     * the original map. */
+
+    for (int i = 0; i < 50; i++) {
+        BoardMap map(15, 10, 0.6);
+
+        QVector<QVector<int> > rows, cols;
+        for (int y = 0; y < map.height(); y++) {
+            rows.append(map.rowClues(y));
+        }
+        for (int x = 0; x < map.width(); x++) {
+            cols.append(map.colClues(x));
+        }
+
+        Solver solver(rows, cols);
+        const Solver::Result result = solver.solve();
+        QVERIFY(result == Solver::Unique || result == Solver::Multiple);
+
+        const BoardMap solution(solver.solution());
+        for (int y = 0; y < map.height(); y++) {
+            QCOMPARE(solution.rowClues(y), rows[y]);
+        }
+        for (int x = 0; x < map.width(); x++) {
+            QCOMPARE(solution.colClues(x), cols[x]);
+        }
+
+        if (result == Solver::Unique) {
+            QVERIFY(solution.packedMap() == map.packedMap());
+        }
+    }
+}
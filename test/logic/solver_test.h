@@ -0,0 +1,17 @@
+#ifndef __SOLVER_TEST_H
+#define __SOLVER_TEST_H
+
+#include <QObject>
+
+class SolverTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testUnique();
+    void testMultiple();
+    void testContradiction();
+    void testRandom();
+};
+
+#endif /* __SOLVER_TEST_H */
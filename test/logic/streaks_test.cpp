@@ -211,6 +211,76 @@ void StreaksTest::test13()
                 ".xx..");
 }
 
+void StreaksTest::testClues()
+{
+    /* .bb.
+     * bbbb
+     * b..b */
+
+    PackedMap packed(4, 3);
+    packed.set(1, 0, Board::Box);
+    packed.set(2, 0, Board::Box);
+    for (int x = 0; x < 4; x++) {
+        packed.set(x, 1, Board::Box);
+    }
+    packed.set(0, 2, Board::Box);
+    packed.set(3, 2, Board::Box);
+
+    BoardMap map(packed);
+
+    /* The map shares the packed bits. */
+    QCOMPARE(map.packedMap().bits().constData(), packed.bits().constData());
+    QCOMPARE(map.boxCount(), 8);
+    QCOMPARE(map.get(1, 0), Board::Box);
+    QCOMPARE(map.get(1, 2), Board::Nothing);
+
+    QCOMPARE(map.rowClues(0), QVector<int>() << 2);
+    QCOMPARE(map.rowClues(1), QVector<int>() << 4);
+    QCOMPARE(map.rowClues(2), QVector<int>() << 1 << 1);
+    QCOMPARE(map.colClues(0), QVector<int>() << 2);
+    QCOMPARE(map.colClues(1), QVector<int>() << 2);
+    QCOMPARE(map.colClues(2), QVector<int>() << 2);
+    QCOMPARE(map.colClues(3), QVector<int>() << 2);
+}
+
+void StreaksTest::testInitial()
+{
+    QSharedPointer<BoardMap> map(new BoardMap(30, 20, 0.5));
+    QSharedPointer<BoardState> state(new BoardState(30, 20));
+
+    /* Streaks of a fresh state are taken from the clues and must match
+     * a full update. */
+
+    Streaks s(map, state);
+
+    QVector<QVector<Streaks::Streak> > rows, cols;
+    for (int y = 0; y < map->height(); y++) {
+        rows.append(s.getRowStreak(y));
+    }
+    for (int x = 0; x < map->width(); x++) {
+        cols.append(s.getColStreak(x));
+    }
+
+    s.update();
+
+    for (int y = 0; y < map->height(); y++) {
+        const QVector<Streaks::Streak> row = s.getRowStreak(y);
+        QCOMPARE(row.size(), rows[y].size());
+        for (int i = 0; i < row.size(); i++) {
+            QCOMPARE(row[i].value, rows[y][i].value);
+            QCOMPARE(row[i].solved, rows[y][i].solved);
+        }
+    }
+    for (int x = 0; x < map->width(); x++) {
+        const QVector<Streaks::Streak> col = s.getColStreak(x);
+        QCOMPARE(col.size(), cols[x].size());
+        for (int i = 0; i < col.size(); i++) {
+            QCOMPARE(col[i].value, cols[x][i].value);
+            QCOMPARE(col[i].solved, cols[x][i].solved);
+        }
+    }
+}
+
 void StreaksTest::bench00()
 {
     QSharedPointer<Streaks> s = generateStreaks("b.b.b.b.bbb.b.b.b.bb",
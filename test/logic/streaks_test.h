@@ -23,6 +23,8 @@ private slots:
     void test11();
     void test12();
     void test13();
+    void testClues();
+    void testInitial();
     void bench00();
 };
 
@@ -0,0 +1,34 @@
+#include "testutil.h"
+
+#include <QStringList>
+
+QSharedPointer<BoardMap> generateMap(const QString &map)
+{
+    const QStringList rows = map.split('\n');
+
+    QList<Board::State> ss;
+    foreach (const QString &row, rows) {
+        foreach (const QChar &c, row) {
+            ss.append((c == 'b') ? Board::Box : Board::Nothing);
+        }
+    }
+
+    return QSharedPointer<BoardMap>(new BoardMap(rows[0].size(), rows.size(), ss));
+}
+
+bool statesEqual(const Picmi &lhs, const Picmi &rhs)
+{
+    if (lhs.width() != rhs.width() || lhs.height() != rhs.height()) {
+        return false;
+    }
+
+    for (int y = 0; y < lhs.height(); y++) {
+        for (int x = 0; x < lhs.width(); x++) {
+            if (lhs.stateAt(x, y) != rhs.stateAt(x, y)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef __TESTUTIL_H
+#define __TESTUTIL_H
+
+#include <QSharedPointer>
+#include <QString>
+
+#include "picmi.h"
+
+/* Helpers shared by the game logic tests. */
+
+/**
+ * Generates a map from its string representation. Rows are separated by '\n',
+ * '.' and 'b' represent Nothing and Box cells respectively.
+ */
+QSharedPointer<BoardMap> generateMap(const QString &map);
+
+/* returns true if both games have the same dimensions and cell states */
+bool statesEqual(const Picmi &lhs, const Picmi &rhs);
+
+#endif /* __TESTUTIL_H */